@@ -0,0 +1,137 @@
+#define _GNU_SOURCE // clock_gettime under -std=c99
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "ppm_io.h"
+#include "img_processing.h"
+#include "pixel_alloc.h"
+#include "bench.h"
+
+//every kernel is timed this many times per policy and the best run kept
+#define BENCH_REPEATS 3
+
+/* kernels timed by the bench */
+enum {BENCH_COPY, BENCH_TRANSPOSE, BENCH_GRADIENT, BENCH_CROP, NUM_BENCH};
+static const char *benchNames[NUM_BENCH] = {"copy", "transpose", "gradient", "crop"};
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* best time in seconds of one kernel under the current policy, or -1 if
+ * memory ran out. The input copy is made with copyIm (plain malloc) outside
+ * the timed region, so only the buffers the kernel itself allocates follow
+ * the policy. The copy kernel times allocRows plus the copy.
+ */
+static double timeKernel(const Image *src, int kernel) {
+    double best = -1;
+    for (int i = 0; i < BENCH_REPEATS; i++) {
+        Image work;
+        double start = now();
+        int status = 0;
+        if (kernel == BENCH_COPY) {
+            work.data = allocRows(src->rows, sizeof(Pixel) * src->cols);
+            if (!work.data) {return -1;}
+            memcpy(work.data, src->data, sizeof(Pixel) * src->rows * src->cols);
+        } else {
+            copyIm((Image *) src, &work);
+            if (!work.data) {return -1;}
+            start = now();
+        }
+
+        if (kernel == BENCH_TRANSPOSE) {
+            status = fastBackend.transpose(&work);
+        } else if (kernel == BENCH_GRADIENT) {
+            status = fastBackend.gradient(&work);
+        } else if (kernel == BENCH_CROP) {
+            //drop a one pixel border, so nearly the whole image is copied;
+            //with no input file to close, crop just returns 8 on failure
+            if (fastBackend.crop(&work, 1, 1, work.cols - 1, work.rows - 1, NULL) == 8) {status = 8;}
+        }
+        double elapsed = now() - start;
+        if (status == 8) {
+            free(work.data);
+            return -1;
+        }
+        if (best < 0 || elapsed < best) {best = elapsed;}
+        free(work.data);
+    }
+    return best;
+}
+
+/* print the transparent huge page mode, e.g. "always [madvise] never" */
+static void printTHP(void) {
+    char mode[128] = "unknown\n";
+    FILE *fp = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+    if (fp) {
+        if (!fgets(mode, sizeof(mode), fp)) {mode[0] = '\0';}
+        fclose(fp);
+    }
+    printf("bench: transparent huge pages: %s", mode);
+}
+
+int benchAlloc(int cols, int rows) {
+    size_t pixels = (size_t) rows * cols;
+    //pixel indices are ints, so the image must stay addressable
+    if (pixels > INT_MAX / 3) {
+        fprintf(stderr, "bench: %dx%d image is too large\n", cols, rows);
+        return 7;
+    }
+    //below the threshold both policies call malloc, and any gain is noise
+    if (sizeof(Pixel) * pixels < ALLOC_HUGE_THRESHOLD) {
+        fprintf(stderr, "bench: %dx%d image is below the %lu MB huge page threshold\n", cols, rows,
+                ALLOC_HUGE_THRESHOLD / (1024 * 1024));
+        return 7;
+    }
+
+    AllocPolicy saved = getAllocPolicy();
+    setAllocPolicy(ALLOC_PLAIN);
+    Image src;
+    src.rows = rows;
+    src.cols = cols;
+    src.data = malloc(sizeof(Pixel) * pixels);
+    if (!src.data) {
+        fprintf(stderr, "bench: failed to allocate memory for test image!\n");
+        return 8;
+    }
+    for (size_t i = 0; i < pixels; i++) {
+        src.data[i].r = rand() % 256;
+        src.data[i].g = rand() % 256;
+        src.data[i].b = rand() % 256;
+    }
+
+    int threads = 1;
+#ifdef _OPENMP
+    threads = omp_get_max_threads();
+#endif
+    printf("bench: %dx%d image (%.1f MB), %d thread(s), best of %d\n", cols, rows,
+           sizeof(Pixel) * (double) rows * cols / 1e6, threads, BENCH_REPEATS);
+    printTHP();
+    printf("%-10s %10s %10s %8s\n", "kernel", "plain_ms", "huge_ms", "gain");
+
+    int status = 0;
+    for (int k = 0; k < NUM_BENCH && !status; k++) {
+        setAllocPolicy(ALLOC_PLAIN);
+        double plain = timeKernel(&src, k);
+        setAllocPolicy(ALLOC_HUGE);
+        double huge = timeKernel(&src, k);
+        if (plain < 0 || huge < 0) {
+            fprintf(stderr, "bench: failed to allocate memory for %s!\n", benchNames[k]);
+            status = 8;
+        } else {
+            printf("%-10s %10.3f %10.3f %7.1f%%\n", benchNames[k], plain * 1e3, huge * 1e3,
+                   (plain - huge) / plain * 100);
+        }
+    }
+
+    free(src.data);
+    setAllocPolicy(saved);
+    return status;
+}
@@ -0,0 +1,16 @@
+#ifndef _BENCH_H_
+#define _BENCH_H_
+
+/* function to time the kernels that allocate pixel buffers (copy,
+ * transpose, gradient, crop) on a generated cols x rows image under
+ * each allocation policy, and print the gain of huge-page, first-touch
+ * allocation over plain malloc.
+ * @param cols is the number of columns of the generated image
+ * @param rows is the number of rows of the generated image
+ * returns 0 on success, 7 if the image is below ALLOC_HUGE_THRESHOLD (where
+ * both policies use malloc) or too large to index, and 8 if memory could
+ * not be allocated
+ */
+int benchAlloc(int cols, int rows);
+
+#endif // _BENCH_H_
@@ -5,10 +5,38 @@
 #include <unistd.h>
 #include "ppm_io.h"
 #include "img_processing.h"
+#include "resize.h"
+#include "perf_stats.h"
+#include "img_reference.h"
+#include "verify.h"
+#include "pixel_alloc.h"
+#include "bench.h"
+
+//edge length of the square tiles transpose copies at a time
+#define TRANSPOSE_TILE 32
+//NTSC luma weights, the ones the reference grayscale uses
+#define LUMA_R 0.3
+#define LUMA_G 0.59
+#define LUMA_B 0.11
+
+const Backend fastBackend = {"fast", grayscale, binarize, binarizeAuto, crop, transpose, gradient, seam};
 
 int img_processing(int argc, char *argv[]) {
     FILE *fp = NULL;
 
+    //--verify compares the backends on generated images and needs no files
+    if (argc >= 2 && !strcmp(argv[1], "--verify")) {
+        if (argc > 3 || (argc == 3 && !isdigit(*argv[2]))) {return printError(1, fp);}
+        return verifyBackends(argc == 3 ? (unsigned) strtoul(argv[2], NULL, 10) : 1);
+    }
+    //--bench compares the allocation policies on a generated image
+    if (argc >= 2 && !strcmp(argv[1], "--bench")) {
+        if (argc != 2 && argc != 4) {return printError(1, fp);}
+        int cols = (argc == 4) ? atoi(argv[2]) : 4000, rows = (argc == 4) ? atoi(argv[3]) : 3000;
+        if (cols < 3 || rows < 3) {return printError(1, fp);}
+        return benchAlloc(cols, rows);
+    }
+
     //argc is always at least 4
     if (argc < 4) {return printError(1, fp);}
     //check that user input file exists.
@@ -17,31 +45,119 @@ int img_processing(int argc, char *argv[]) {
     fp = fopen(argv[1], "rb");
     if (!fp) {return printError(2, fp);}
 
-    Image *im = ReadPPM(fp);
-    if (!im) {return printError(4, fp);}
+    //strip options that precede the operation name
+    Options opt;
+    int parsed = parseOptions(&argc, argv, &opt, fp);
+    if (parsed != -1) {return parsed;}
+
+    //thumb dimensions that do not fit the image are invalid arguments, not
+    //a decode failure; the header is read again by ReadPPMResized
+    if (opt.thumb) {
+        Image header;
+        if (ReadPPMHeader(fp, &header) == -1) {return printError(4, fp);}
+        if (fitDims(header.cols, header.rows, &opt.thumbCols, &opt.thumbRows) == -1) {return printError(7, fp);}
+        rewind(fp);
+    }
+
+    //counters are opened before any worker threads start, so they inherit into them
+    PerfCounters *pc = opt.perf ? perfOpen() : NULL;
+    PerfStage stages[3];
+
+    //with --thumb the image is reduced while it is decoded
+    perfStart(pc, &stages[0], "read");
+    Image *im = opt.thumb ? ReadPPMResized(fp, opt.thumbCols, opt.thumbRows, opt.thumbFilter) : ReadPPM(fp);
+    perfStop(pc, &stages[0], ftell(fp));
+    if (!im) {
+        perfClose(pc);
+        return printError(4, fp);
+    }
 
     //perform operation
-    int op = operation(argc, argv, im, fp);
+    long long inBytes = sizeof(Pixel) * (long long) im->rows * im->cols;
+    perfStart(pc, &stages[1], argv[3]);
+    int op = operation(argc, argv, im, fp, opt.backend);
+    perfStop(pc, &stages[1], inBytes + sizeof(Pixel) * (long long) im->rows * im->cols);
     //return 0 if operation was successful
     if (op == -1) {
+        perfStart(pc, &stages[2], "write");
         int written = writePPMfile(argv, im);
+        perfStop(pc, &stages[2], sizeof(Pixel) * (long long) im->rows * im->cols);
         destroy(im);
+        perfReport(stderr, pc, stages, 3);
+        perfClose(pc);
         if (written == -1) {return printError(8, fp);}
         fclose(fp);
         return 0;
     }
     
     destroy(im);
+    perfClose(pc);
     return op;    
 }
 
-int operation(int argc, char *argv[], Image *im, FILE *fp) {
+int parseOptions(int *argc, char *argv[], Options *opt, FILE *fp) {
+    opt->thumb = 0;
+    opt->thumbCols = 0;
+    opt->thumbRows = 0;
+    opt->thumbFilter = FILTER_BOX;
+    opt->perf = 0;
+    opt->backend = &fastBackend;
+
+    //options sit between the output file name and the operation name
+    int i = 3;
+    while (i < *argc && !strncmp(argv[i], "--", 2)) {
+        if (!strcmp(argv[i], "--thumb")) {
+            //--thumb takes columns, rows and a filter name
+            if (i + 3 >= *argc) {return printError(6, fp);}
+            if ((!isdigit(*argv[i + 1])) || (!isdigit(*argv[i + 2]))) {return printError(7, fp);}
+            opt->thumb = 1;
+            opt->thumbCols = atoi(argv[i + 1]);
+            opt->thumbRows = atoi(argv[i + 2]);
+            if (opt->thumbCols == 0 && opt->thumbRows == 0) {return printError(7, fp);}
+            if (parseFilter(argv[i + 3], &opt->thumbFilter) == -1) {return printError(7, fp);}
+            i += 4;
+        } else if (!strcmp(argv[i], "--backend")) {
+            //--backend takes "fast" or "ref"
+            if (i + 1 >= *argc) {return printError(6, fp);}
+            if (!strcmp(argv[i + 1], "fast")) {
+                opt->backend = &fastBackend;
+            } else if (!strcmp(argv[i + 1], "ref")) {
+                opt->backend = &refBackend;
+            } else {return printError(7, fp);}
+            i += 2;
+        } else if (!strcmp(argv[i], "--alloc")) {
+            //--alloc takes "huge" or "plain"
+            if (i + 1 >= *argc) {return printError(6, fp);}
+            if (!strcmp(argv[i + 1], "huge")) {
+                setAllocPolicy(ALLOC_HUGE);
+            } else if (!strcmp(argv[i + 1], "plain")) {
+                setAllocPolicy(ALLOC_PLAIN);
+            } else {return printError(7, fp);}
+            i += 2;
+        } else if (!strcmp(argv[i], "--perf")) {
+            opt->perf = 1;
+            i += 1;
+        } else {return printError(5, fp);}
+    }
+
+    //shift the operation and its parameters down to argv[3]
+    int consumed = i - 3;
+    for (int j = 3; j + consumed < *argc; j++) {
+        argv[j] = argv[j + consumed];
+    }
+    *argc -= consumed;
+    //the operation name is still mandatory
+    if (*argc < 4) {return printError(1, fp);}
+    return -1;
+}
+
+int operation(int argc, char *argv[], Image *im, FILE *fp, const Backend *be) {
 
     //find out which operation the user wants to execute
     if (!strcmp(argv[3], "grayscale")) {
         //grayscale should have no extra arguments
         if (argc > 4) {return printError(6, fp);}
-        grayscale(im);
+        be->grayscale(im);
         return -1;
     } else if (!strcmp(argv[3], "crop")) {
         // crop should have additional 4 args (2 sets of co-ordinates, top left and bottom right)
@@ -51,26 +167,31 @@ int operation(int argc, char *argv[], Image *im, FILE *fp) {
         int cropRows = y2 - y1, cropCols = x2 - x1;
         //new image dimensions should make sense
         if ((cropRows < 0) || (cropCols < 0)) {return printError(7, fp);}
-        return crop(im, x1, y1, x2, y2, fp);
+        return be->crop(im, x1, y1, x2, y2, fp);
     } else if (!strcmp(argv[3], "binarize")) {
         //binarize op should have 1 additional argument
         if (argc != 5) {return printError(6, fp);}
+        //"auto" picks the Otsu threshold of the image itself
+        if (!strcmp(argv[4], "auto")) {
+            if (be->binarizeAuto(im) == 8) {return printError(8, fp);}
+            return -1;
+        }
         if (!isdigit(*argv[4])) {return printError(7, fp);}
         int threshold = atoi(argv[4]);
         //check threshold is in correct range
         if ((threshold < 0) || (threshold > 255)) {return printError(7, fp);}
-        binarize(im, threshold);
+        be->binarize(im, threshold);
         return -1;
     } else if (!strcmp(argv[3], "transpose")) {
         //transpose should have no extra arguments
         if (argc > 4) {return printError(6, fp);}
         //reach here means all good, carry out transpose op
-        if (transpose(im) == 8) {printError(8, fp);}
+        if (be->transpose(im) == 8) {return printError(8, fp);}
         return -1;
     } else if (!strcmp(argv[3], "gradient")) {
         //gradient should have no extra arguments
         if (argc > 4) {return printError(6, fp);}
-        gradient(im);
+        if (be->gradient(im) == 8) {return printError(8, fp);}
         return -1;
     } else if (!strcmp(argv[3], "seam")) {
         //seam should have two extra arguments between 0 and 1, inclusive
@@ -79,59 +200,109 @@ int operation(int argc, char *argv[], Image *im, FILE *fp) {
         if ((!isdigit(*argv[4])) || (!isdigit(*argv[5]))) {return printError(7, fp);}
         double scaleCol = atof(argv[4]), scaleRow = atof(argv[5]);
         if ((scaleCol > 1) || (scaleCol < 0) || (scaleRow > 1) || (scaleRow < 0)) {return printError(7, fp);}
-        seam(im, scaleCol, scaleRow);
+        if (be->seam(im, scaleCol, scaleRow) == 8) {return printError(8, fp);}
+        return -1;
+    } else if (!strcmp(argv[3], "analyze")) {
+        //analyze should have no extra arguments; the image is written out unchanged
+        if (argc > 4) {return printError(6, fp);}
+        Stats st;
+        if (analyzeImage(im, &st, NULL, 1) == 8) {return printError(8, fp);}
+        printStats(stdout, im, &st);
+        return -1;
+    } else if (!strcmp(argv[3], "resize")) {
+        //resize takes output columns and rows, and optionally a filter (box by default)
+        if ((argc != 6) && (argc != 7)) {return printError(6, fp);}
+        if ((!isdigit(*argv[4])) || (!isdigit(*argv[5]))) {return printError(7, fp);}
+        int outCols = atoi(argv[4]), outRows = atoi(argv[5]);
+        Filter filter = FILTER_BOX;
+        if ((argc == 7) && (parseFilter(argv[6], &filter) == -1)) {return printError(7, fp);}
+        //a zero dimension keeps the aspect ratio
+        if (fitDims(im->cols, im->rows, &outCols, &outRows) == -1) {return printError(7, fp);}
+        if (resize(im, outCols, outRows, filter) == 8) {return printError(8, fp);}
         return -1;
     }
 
     return printError(5, fp);
 }
 
-void grayscale(Image *im) {
+/* each channel value times its luma weight, rounded to double as the
+ * reference grayscale rounds it; adding the three in the same order gives
+ * the same truncated value for every pixel. Filled by lumaTables.
+ */
+static double lumaTab[3][256];
+static int lumaTabReady = 0;
+
+/* fill lumaTab; called outside parallel regions, before luma runs */
+static void lumaTables(void) {
+    if (lumaTabReady) {return;}
+    for (int v = 0; v < 256; v++) {
+        lumaTab[0][v] = LUMA_R*v;
+        lumaTab[1][v] = LUMA_G*v;
+        lumaTab[2][v] = LUMA_B*v;
+    }
+    lumaTabReady = 1;
+}
+
+/* NTSC luma of one pixel, truncated exactly as the reference grayscale
+ * does, so every backend agrees on gray levels. This stays scalar:
+ * without AVX gcc does not vectorize bytes to doubles, and splitting the
+ * loop so the double math vectorizes measured slower than the lookups,
+ * which replace three conversions and multiplies per pixel.
+ */
+static unsigned char luma(Pixel p) {
+    return (unsigned char) (lumaTab[0][p.r] + lumaTab[1][p.g] + lumaTab[2][p.b]);
+}
+
+/* luma of one row of pixels */
+static void lumaRow(const Pixel *src, int cols, unsigned char *out) {
+    for (int c = 0; c < cols; c++) {
+        out[c] = luma(src[c]);
+    }
+}
 
-    unsigned char intensity;
+void grayscale(Image *im) {
+    lumaTables();
+    #pragma omp parallel for schedule(static)
     for (int r = 0; r < im->rows; r++) {
+        Pixel *row = &im->data[r * im->cols];
         for (int c = 0; c < im->cols; c++) {
-            intensity = 0.3*im->data[(r * im->cols) + c].r + 0.59*im->data[(r * im->cols) + c].g + 0.11*im->data[(r * im->cols) + c].b;
+            unsigned char intensity = luma(row[c]);
             //update pixel intensity
-            im->data[(r * im->cols) + c].r = intensity;
-            im->data[(r * im->cols) + c].g = intensity;
-            im->data[(r * im->cols) + c].b = intensity;
+            row[c].r = intensity;
+            row[c].g = intensity;
+            row[c].b = intensity;
         }
     }
 }
 
 void binarize(Image *im, int threshold) {
-
-    //intensity will be either 0 or 255 for each pixel
-    unsigned char intensity;
+    lumaTables();
+    #pragma omp parallel for schedule(static)
     for (int r = 0; r < im->rows; r++) {
+        Pixel *row = &im->data[r * im->cols];
         for (int c = 0; c < im->cols; c++) {
-            intensity = 0.3*im->data[(r * im->cols) + c].r + 0.59*im->data[(r * im->cols) + c].g + 0.11*im->data[(r * im->cols) + c].b;
-            if (intensity < threshold) {
-                intensity = 0;
-            } else {intensity = 255;}
-
-            im->data[(r * im->cols) + c].r = intensity;
-            im->data[(r * im->cols) + c].g = intensity;
-            im->data[(r * im->cols) + c].b = intensity;
+            //intensity will be either 0 or 255 for each pixel
+            unsigned char intensity = (luma(row[c]) < threshold) ? 0 : 255;
+            row[c].r = intensity;
+            row[c].g = intensity;
+            row[c].b = intensity;
         }
     }
-
 }
 
 int crop(Image *im, int x1, int y1, int x2, int y2, FILE *fp) {
-    //check if memory allocated successfully
-    Pixel *cropPix = malloc(sizeof(Pixel) * (y2 - y1) * (x2 - x1));
-    if (!cropPix) {return printError(8, fp);}
-
     //dimensions of new image
     int cropRows = y2 - y1;
     int cropCols = x2 - x1;
 
+    //check if memory allocated successfully
+    Pixel *cropPix = allocRows(cropRows, sizeof(Pixel) * cropCols);
+    if (!cropPix) {return fp ? printError(8, fp) : 8;}
+
+    //each output row is one contiguous run of an input row
+    #pragma omp parallel for schedule(static)
     for (int r = 0; r < cropRows; r++) {
-        for (int c = 0; c <cropCols; c++) {
-            cropPix[(r * cropCols) + c] = im->data[((y1 + r) * im->cols) + x1 + c];
-        }
+        memcpy(&cropPix[r * cropCols], &im->data[((y1 + r) * im->cols) + x1], sizeof(Pixel) * cropCols);
     }
 
     free(im->data);
@@ -142,125 +313,401 @@ int crop(Image *im, int x1, int y1, int x2, int y2, FILE *fp) {
 }
 
 int transpose(Image *im) {
+    int rows = im->rows, cols = im->cols;
 
-    Pixel *transposePix = malloc(sizeof(Pixel) * im->rows * im->cols);
+    Pixel *transposePix = allocRows(cols, sizeof(Pixel) * rows);
     //check if memory allocated successfully
     if (!transposePix) {return 8;}
-    
-    //new(x,y) gets old(y,x)
-    for (int r = 0; r < im->rows; r++) {
-        for (int c = 0; c <im->cols; c++) {
-            transposePix[(c * im->rows) + r] = im->data[(r * im->cols) + c];
+
+    //new(x,y) gets old(y,x), one tile at a time so the strided writes stay in cache
+    #pragma omp parallel for schedule(static)
+    for (int r0 = 0; r0 < rows; r0 += TRANSPOSE_TILE) {
+        int r1 = (r0 + TRANSPOSE_TILE < rows) ? r0 + TRANSPOSE_TILE : rows;
+        for (int c0 = 0; c0 < cols; c0 += TRANSPOSE_TILE) {
+            int c1 = (c0 + TRANSPOSE_TILE < cols) ? c0 + TRANSPOSE_TILE : cols;
+            for (int r = r0; r < r1; r++) {
+                for (int c = c0; c < c1; c++) {
+                    transposePix[(c * rows) + r] = im->data[(r * cols) + c];
+                }
+            }
         }
     }
 
     //update image
     free(im->data);
     im->data = transposePix;
-    int tempRow = im->rows;
-    im->rows = im->cols;
-    im->cols = tempRow;
+    im->rows = cols;
+    im->cols = rows;
     return 0;
 }
 
-void gradient(Image *im) {
-    
-    grayscale(im);
-    Pixel *gradPix = malloc(sizeof(Pixel) * im->rows * im->cols);
-    int gradx;
-    int grady;
-    //grad is absolute sum of gradx and grady
-    int grad;
-
+/* fill a luma plane (one byte per pixel) from an image */
+static void lumaPlane(const Image *im, unsigned char *lum) {
+    lumaTables();
+    #pragma omp parallel for schedule(static)
     for (int r = 0; r < im->rows; r++) {
-        for (int c = 0; c < im->cols; c++) {
-            //boundary pixels get energy zero
-            if (c == 0 || c == (im->cols - 1) || r == 0 || r == (im->rows - 1)) {
-                grad = 0;
-            } else {
-                gradx = (im->data[(r * im->cols) + c + 1].r - im->data[(r * im->cols) + c - 1].r) / 2;
-                grady = (im->data[(r * im->cols) + c + im->cols].r - im->data[(r * im->cols) + c - im->cols].r) / 2;
-                grad = abs(gradx) + abs(grady);
-            }
-            gradPix[(r * im->cols) + c].r = grad;
-            gradPix[(r * im->cols) + c].g = grad;
-            gradPix[(r * im->cols) + c].b = grad;
+        lumaRow(&im->data[r * im->cols], im->cols, &lum[r * im->cols]);
+    }
+}
+
+/* energy of an interior row, columns c0 to c1 inclusive, from the luma
+ * rows above (up), at (mid) and below (down) it
+ */
+static void energyFromRows(const unsigned char *up, const unsigned char *mid, const unsigned char *down,
+                           int cols, int c0, int c1, unsigned char *out) {
+    //boundary pixels get energy zero; keeping them out of the loop lets it vectorize
+    if (c0 == 0) {out[0] = 0;}
+    if (c1 == cols - 1) {out[cols - 1] = 0;}
+    int lo = (c0 < 1) ? 1 : c0, hi = (c1 > cols - 2) ? cols - 2 : c1;
+    #pragma omp simd
+    for (int c = lo; c <= hi; c++) {
+        int gradx = (mid[c + 1] - mid[c - 1]) / 2;
+        int grady = (down[c] - up[c]) / 2;
+        out[c] = abs(gradx) + abs(grady);
+    }
+}
+
+/* energy (the gradient of the reference backend) of row r, columns c0
+ * to c1 inclusive, computed from a luma plane into the energy row out
+ */
+static void energyRow(const unsigned char *lum, int rows, int cols, int r, int c0, int c1, unsigned char *out) {
+    //boundary pixels get energy zero
+    if (r == 0 || r == rows - 1) {
+        memset(&out[c0], 0, c1 - c0 + 1);
+        return;
+    }
+    const unsigned char *row = &lum[r * cols];
+    energyFromRows(row - cols, row, row + cols, cols, c0, c1, out);
+}
+
+int gradient(Image *im) {
+    int rows = im->rows, cols = im->cols;
+    unsigned char *lum = allocRows(rows, cols);
+    unsigned char *en = allocRows(rows, cols);
+    Pixel *gradPix = allocRows(rows, sizeof(Pixel) * cols);
+    if (!lum || !en || !gradPix) {
+        free(lum);
+        free(en);
+        free(gradPix);
+        return 8;
+    }
+
+    //the whole luma plane must exist before any row can look at its neighbors
+    lumaPlane(im, lum);
+    #pragma omp parallel for schedule(static)
+    for (int r = 0; r < rows; r++) {
+        energyRow(lum, rows, cols, r, 0, cols - 1, &en[r * cols]);
+        for (int c = 0; c < cols; c++) {
+            gradPix[(r * cols) + c].r = en[(r * cols) + c];
+            gradPix[(r * cols) + c].g = en[(r * cols) + c];
+            gradPix[(r * cols) + c].b = en[(r * cols) + c];
         }
     }
 
+    free(lum);
+    free(en);
     free(im->data);
     im->data = gradPix;
+    return 0;
 }
 
-void seam(Image *im, float scaleCol, float scaleRow) {
-    Image* copy = malloc(sizeof(Image));
-    copyIm(im, copy);
+int otsuThreshold(const long long hist[256]) {
+    long long total = 0;
+    double sum = 0;
+    for (int i = 0; i < 256; i++) {
+        total += hist[i];
+        sum += (double) i * hist[i];
+    }
 
-    int numColRemove = im->cols * (1 - scaleCol);
-    int numRowRemove = im->rows * (1 - scaleRow);
+    //pick the split that maximizes the between-class variance (first one on ties)
+    long long below = 0;
+    double sumBelow = 0, best = -1;
+    int split = 0;
+    for (int t = 0; t < 256; t++) {
+        below += hist[t];
+        sumBelow += (double) t * hist[t];
+        if (below == 0) {continue;}
+        long long above = total - below;
+        if (above == 0) {break;}
+        double diff = sumBelow / below - (sum - sumBelow) / above;
+        double between = (double) below * above * diff * diff;
+        if (between > best) {
+            best = between;
+            split = t;
+        }
+    }
+    //binarize turns pixels below the threshold black, so the split value itself must be below it
+    return (split + 1 > 255) ? 255 : split + 1;
+}
 
-    //minimum output image size should be 2x2
-    if (im->cols - numColRemove < 2) {
-        numColRemove = im->cols - 2;
+/* fill in min, max and mean from a histogram of n samples */
+static void histSummary(const long long hist[256], long long n, int *min, int *max, double *mean) {
+    double sum = 0;
+    *min = 255;
+    *max = 0;
+    for (int i = 0; i < 256; i++) {
+        if (!hist[i]) {continue;}
+        if (i < *min) {*min = i;}
+        if (i > *max) {*max = i;}
+        sum += (double) i * hist[i];
     }
-    if (im->rows - numRowRemove < 2) {
-        numRowRemove = im->rows - 2;
+    *mean = sum / n;
+}
+
+int analyzeImage(const Image *im, Stats *st, unsigned char *lum, int withEnergy) {
+    int rows = im->rows, cols = im->cols;
+    memset(st, 0, sizeof(Stats));
+    int failed = 0;
+    lumaTables();
+
+    #pragma omp parallel
+    {
+        long long lumaHist[256] = {0}, energyHist[256] = {0};
+        //rolling window of luma rows, row k in slot k % 3; energy needs rows r-1 to r+1
+        unsigned char *win = malloc(3 * cols);
+        unsigned char *en = malloc(cols);
+        int winRow[3] = {-1, -1, -1};
+        if (!win || !en) {
+            #pragma omp atomic write
+            failed = 1;
+        }
+
+        #pragma omp for schedule(static)
+        for (int r = 0; r < rows; r++) {
+            if (!win || !en) {continue;}
+            //each luma row is computed once per thread; only band edges are computed twice
+            int lo = withEnergy ? r - 1 : r, hi = withEnergy ? r + 1 : r;
+            for (int k = lo; k <= hi; k++) {
+                if (k < 0 || k >= rows || winRow[k % 3] == k) {continue;}
+                lumaRow(&im->data[k * cols], cols, &win[(k % 3) * cols]);
+                winRow[k % 3] = k;
+            }
+
+            const unsigned char *cur = &win[(r % 3) * cols];
+            for (int c = 0; c < cols; c++) {
+                lumaHist[cur[c]]++;
+            }
+            if (lum) {memcpy(&lum[r * cols], cur, cols);}
+
+            if (withEnergy) {
+                //boundary pixels get energy zero
+                if (r == 0 || r == rows - 1) {
+                    energyHist[0] += cols;
+                } else {
+                    energyFromRows(&win[((r - 1) % 3) * cols], cur, &win[((r + 1) % 3) * cols], cols, 0, cols - 1, en);
+                    for (int c = 0; c < cols; c++) {
+                        energyHist[en[c]]++;
+                    }
+                }
+            }
+        }
+
+        #pragma omp critical
+        {
+            for (int i = 0; i < 256; i++) {
+                st->lumaHist[i] += lumaHist[i];
+                st->energyHist[i] += energyHist[i];
+            }
+        }
+        free(win);
+        free(en);
     }
-    //remove columns
-    for (int i = 0; i < numColRemove; i++) {
-        gradient(im);
-        seamCarve(im, copy);
+    if (failed) {return 8;}
+
+    long long n = (long long) rows * cols;
+    histSummary(st->lumaHist, n, &st->lumaMin, &st->lumaMax, &st->lumaMean);
+    if (withEnergy) {histSummary(st->energyHist, n, &st->energyMin, &st->energyMax, &st->energyMean);}
+    st->otsu = otsuThreshold(st->lumaHist);
+    return 0;
+}
+
+void printStats(FILE *out, const Image *im, const Stats *st) {
+    fprintf(out, "size %d %d\n", im->cols, im->rows);
+    fprintf(out, "luma min %d max %d mean %.3f\n", st->lumaMin, st->lumaMax, st->lumaMean);
+    fprintf(out, "energy min %d max %d mean %.3f\n", st->energyMin, st->energyMax, st->energyMean);
+    fprintf(out, "otsu %d\n", st->otsu);
+    fprintf(out, "luma_hist");
+    for (int i = 0; i < 256; i++) {
+        fprintf(out, " %lld", st->lumaHist[i]);
     }
-    
-    transpose(im);
-    transpose(copy);
-    //now remove rows
-    for (int j = 0; j < numRowRemove; j++) {
-        gradient(im);
-        seamCarve(im, copy);
-    }
-    transpose(im);
-    
-    destroy(copy);
+    fprintf(out, "\nenergy_hist");
+    for (int i = 0; i < 256; i++) {
+        fprintf(out, " %lld", st->energyHist[i]);
+    }
+    fprintf(out, "\n");
 }
 
-void seamCarve(Image *im, Image *copy) {
-
-    //for an image with c# columns, create array of size c#. Each element holds cumulative energy of each seam
-    int *seamEnergy = calloc(im->cols, sizeof(int));
-    //2D array. Each row of seamArr contains a seam. The seam is stored as the index of each pixel.
-    int *seamArr = calloc((im->cols * im->rows), sizeof(int));
-    int target;
-    int a = 0;
-    int b = 0;
-    for (b = 0; b < im->cols; b++) {
-        a = 0;
-        seamArr[(b * im->rows)] = b;
-        target = b + assignDIR(im, a, b);
-        for (a = 1; a < im->rows; a++) {
-            seamArr[(b * im->rows) + a] = target;
-            seamEnergy[b] += (int) im->data[(a * im->cols) + target].r;
-            target += assignDIR(im, a, target);
+int binarizeAuto(Image *im) {
+    unsigned char *lum = allocRows(im->rows, im->cols);
+    if (!lum) {return 8;}
+
+    //one pass over the pixels yields both the histogram and the luma plane
+    Stats st;
+    if (analyzeImage(im, &st, lum, 0) == 8) {
+        free(lum);
+        return 8;
+    }
+
+    //the threshold is applied from the luma plane instead of recomputing luma from RGB
+    #pragma omp parallel for schedule(static)
+    for (int r = 0; r < im->rows; r++) {
+        Pixel *row = &im->data[r * im->cols];
+        const unsigned char *l = &lum[r * im->cols];
+        for (int c = 0; c < im->cols; c++) {
+            unsigned char intensity = (l[c] < st.otsu) ? 0 : 255;
+            row[c].r = intensity;
+            row[c].g = intensity;
+            row[c].b = intensity;
         }
     }
 
-    //which seam has the lowest energy?
-    int minEnergyIndex = 0;
-    for (int j = 1; j < im->cols; j++) {
-        if (seamEnergy[j] < seamEnergy[minEnergyIndex]) {minEnergyIndex = j;}
+    free(lum);
+    return 0;
+}
+
+/* assignDIR on an energy plane instead of a gradient Image */
+static int stepDIR(const unsigned char *en, int rows, int cols, int a, int b) {
+    //mid, left and right are the target pixel's neighbors on the next row
+    int mid = 0;
+    int left = 0;
+    int right = 0;
+    if (a < rows - 1) {
+        mid = en[((a + 1) * cols) + b];
+        if (b > 1) {left = en[((a + 1) * cols) + b - 1];}
+        if (b < cols - 2) {right = en[((a + 1) * cols) + b + 1];}
     }
+    return chooseDIR(mid, right, left, a, b, cols);
+}
 
-    //now remove it!
-    removeSeam(copy, seamArr, minEnergyIndex);
+/* follow the greedy seam starting at column b of the first row, exactly
+ * as seamCarveRef does. Returns its energy; if path is not NULL, the
+ * column of the seam in every row is stored there.
+ */
+static int traceSeam(const unsigned char *en, int rows, int cols, int b, int *path) {
+    int energy = 0;
+    int target = b + stepDIR(en, rows, cols, 0, b);
+    if (path) {path[0] = b;}
+    for (int a = 1; a < rows; a++) {
+        if (path) {path[a] = target;}
+        energy += en[(a * cols) + target];
+        target += stepDIR(en, rows, cols, a, target);
+    }
+    return energy;
+}
 
-    //clean up memory
-    free(im->data);
-    copyIm(copy, im);
+/* remove one element per row (the column in path) from a row-major plane
+ * of elements of the given size, compacting it in place
+ */
+static void removePath(void *data, size_t size, int rows, int cols, const int *path) {
+    unsigned char *d = data;
+    //rows only move towards the front, so going in order never clobbers unread data
+    for (int r = 0; r < rows; r++) {
+        unsigned char *src = d + ((size_t) r * cols * size);
+        unsigned char *dst = d + ((size_t) r * (cols - 1) * size);
+        memmove(dst, src, path[r] * size);
+        memmove(dst + (path[r] * size), src + ((path[r] + 1) * size), (cols - 1 - path[r]) * size);
+    }
+}
+
+/* remove n vertical seams, choosing each one as seamCarveRef would. The
+ * luma and energy planes are carved along with the image, and only the
+ * energies whose neighbors changed are recomputed after each removal.
+ * Returns 0 on success and 8 if memory could not be allocated.
+ */
+static int carveSeams(Image *im, int n) {
+    if (n <= 0) {return 0;}
+    int rows = im->rows, cols = im->cols;
+    unsigned char *lum = allocRows(rows, cols);
+    unsigned char *en = allocRows(rows, cols);
+    int *seamEnergy = malloc(sizeof(int) * cols);
+    int *path = malloc(sizeof(int) * rows);
+    if (!lum || !en || !seamEnergy || !path) {
+        free(lum);
+        free(en);
+        free(seamEnergy);
+        free(path);
+        return 8;
+    }
+
+    lumaPlane(im, lum);
+    #pragma omp parallel for schedule(static)
+    for (int r = 0; r < rows; r++) {
+        energyRow(lum, rows, cols, r, 0, cols - 1, &en[r * cols]);
+    }
+
+    for (int i = 0; i < n; i++) {
+        //cumulative energy of the seam starting at each column
+        #pragma omp parallel for schedule(static)
+        for (int b = 0; b < cols; b++) {
+            seamEnergy[b] = traceSeam(en, rows, cols, b, NULL);
+        }
 
-    free(seamArr);
+        //which seam has the lowest energy? (the leftmost one on ties)
+        int minEnergyIndex = 0;
+        for (int j = 1; j < cols; j++) {
+            if (seamEnergy[j] < seamEnergy[minEnergyIndex]) {minEnergyIndex = j;}
+        }
+        traceSeam(en, rows, cols, minEnergyIndex, path);
+        //a seam stepping off the image removes the edge column, as in removeSeamRef
+        for (int r = 0; r < rows; r++) {
+            if (path[r] < 0) {path[r] = 0;}
+            if (path[r] > cols - 1) {path[r] = cols - 1;}
+        }
+
+        //now remove it!
+        removePath(im->data, sizeof(Pixel), rows, cols, path);
+        removePath(lum, 1, rows, cols, path);
+        removePath(en, 1, rows, cols, path);
+        cols -= 1;
+        im->cols = cols;
+
+        //a pixel's energy changes only if it was next to the seam, or if the
+        //seam shifted its upper or lower neighbor
+        #pragma omp parallel for schedule(static)
+        for (int r = 0; r < rows; r++) {
+            int lo = path[r], hi = path[r];
+            if (r > 0) {
+                lo = (path[r - 1] < lo) ? path[r - 1] : lo;
+                hi = (path[r - 1] > hi) ? path[r - 1] : hi;
+            }
+            if (r < rows - 1) {
+                lo = (path[r + 1] < lo) ? path[r + 1] : lo;
+                hi = (path[r + 1] > hi) ? path[r + 1] : hi;
+            }
+            lo = (lo - 1 < 0) ? 0 : lo - 1;
+            hi = (hi > cols - 1) ? cols - 1 : hi;
+            energyRow(lum, rows, cols, r, lo, hi, &en[r * cols]);
+        }
+    }
+
+    free(lum);
+    free(en);
     free(seamEnergy);
+    free(path);
+    return 0;
 }
 
+int seam(Image *im, float scaleCol, float scaleRow) {
+    int numColRemove = im->cols * (1 - scaleCol);
+    int numRowRemove = im->rows * (1 - scaleRow);
+
+    //minimum output image size should be 2x2
+    if (im->cols - numColRemove < 2) {
+        numColRemove = im->cols - 2;
+    }
+    if (im->rows - numRowRemove < 2) {
+        numRowRemove = im->rows - 2;
+    }
+    //remove columns
+    if (carveSeams(im, numColRemove) == 8) {return 8;}
+
+    //now remove rows, as columns of the transposed image
+    if (numRowRemove > 0) {
+        if (transpose(im) == 8 || carveSeams(im, numRowRemove) == 8) {return 8;}
+        return transpose(im);
+    }
+    return 0;
+}
 
 int helpAssign(int mid, int right, int left, char position) {
 
@@ -309,14 +756,17 @@ int assignDIR(Image *im, int a, int b) {
         if (b > 1) {left = im->data[((a + 1) * im->cols) + b - 1].r;}
         if (b < im->cols - 2) {right = im->data[((a + 1) * im->cols) + b + 1].r;}
     }
-    
+    return chooseDIR(mid, right, left, a, b, im->cols);
+}
+
+int chooseDIR(int mid, int right, int left, int a, int b, int cols) {
     //are we at first row of image?
     if (a == 0) {
         if (b == 0) {
             return 1;
-        } else if (b == im->cols - 1) {
+        } else if (b == cols - 1) {
             return -1;
-        } else if (b == im->cols - 2) {
+        } else if (b == cols - 2) {
             return helpAssign(mid, right, left, 'r');
         } else if (b == 1) {
             return helpAssign(mid, right, left, 'l');
@@ -326,7 +776,7 @@ int assignDIR(Image *im, int a, int b) {
     } else if (a > 0) {
         if (b == 1) {
             return helpAssign(mid, right, left, 'l');
-        } else if (b == im->cols - 2) {
+        } else if (b == cols - 2) {
             return helpAssign(mid, right, left, 'r');
         } else {
             return helpAssign(mid, right, left, 'm');
@@ -334,26 +784,3 @@ int assignDIR(Image *im, int a, int b) {
     }
     return 0;
 }
-
-void removeSeam(Image *im, int *seamArr, int targetIndex) {
-
-    targetIndex = im->rows * targetIndex;
-    Pixel *newPix = malloc(sizeof(Pixel) * im->rows * (im->cols - 1));
-    for (int r = 0; r < im->rows; r++) {
-        for (int c = 0; c < im->cols - 1; c++) {
-            //do not copy if current element is pixel that is to be removed
-            if (c < seamArr[targetIndex]) {
-                newPix[(r * (im->cols - 1)) + c] = im->data[(r * im->cols) + c];
-            } else {
-                newPix[(r * (im->cols - 1)) + c] = im->data[(r * im->cols) + c + 1];
-            }
-        }
-            targetIndex += 1;
-    }
-    // output image has one less column
-    im->cols -= 1;
-    
-    free(im->data);
-    im->data = newPix;
-    
-}
\ No newline at end of file
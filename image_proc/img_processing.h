@@ -1,6 +1,51 @@
 #ifndef _IMG_PROCESS_H_
 #define _IMG_PROCESS_H_
 #include <stdio.h>
+#include "resize.h"
+
+/* A struct to hold one implementation of every operation that has both
+ * an optimized and a reference version. fastBackend (img_processing.c) is
+ * the default; refBackend (img_reference.c) is selected with --backend ref.
+ */
+typedef struct _backend {
+    const char *name;
+    void (*grayscale)(Image *im);
+    void (*binarize)(Image *im, int threshold);
+    int (*binarizeAuto)(Image *im);
+    int (*crop)(Image *im, int x1, int y1, int x2, int y2, FILE *fp);
+    int (*transpose)(Image *im);
+    int (*gradient)(Image *im);
+    int (*seam)(Image *im, float scaleCol, float scaleRow);
+} Backend;
+
+extern const Backend fastBackend;
+
+/* A struct to hold the image statistics computed by analyze. Luma is the
+ * grayscale intensity and energy the gradient value of every pixel.
+ */
+typedef struct _stats {
+    long long lumaHist[256];   // number of pixels with each luma
+    long long energyHist[256]; // number of pixels with each energy
+    int lumaMin;
+    int lumaMax;
+    double lumaMean;
+    int energyMin;
+    int energyMax;
+    double energyMean;
+    int otsu;                  // Otsu threshold, ready to pass to binarize
+} Stats;
+
+/* A struct to hold the options that may precede the operation name,
+ *   ./project <input> <output> [options] <operation name> [operation params]
+ */
+typedef struct _options {
+    int thumb;          // nonzero if --thumb was given
+    int thumbCols;      // --thumb output columns (0 keeps aspect ratio)
+    int thumbRows;      // --thumb output rows (0 keeps aspect ratio)
+    Filter thumbFilter; // --thumb resampling filter
+    int perf;           // nonzero if --perf was given
+    const Backend *backend; // --backend, fastBackend unless "ref" was given
+} Options;
 
 /* This is the primary functino of the file.
  * function to initialize file pointers and images and provides some I/O error checks.
@@ -9,28 +54,74 @@
  */
 int img_processing(int argc, char *argv[]);
 
+/* function to parse the options between the output file name and the
+ * operation name, and remove them from argv so the operation name ends
+ * up in argv[3] again.
+ * @param argc is a pointer to the number of command line arguments, updated in place
+ * @param argv is user input, updated in place
+ * @param opt receives the parsed options
+ * @param fp is the file pointer to the user inputted image
+ * returns -1 on success, otherwise the error number
+ */
+int parseOptions(int *argc, char *argv[], Options *opt, FILE *fp);
+
 /* function to determine which operation the user wants
  * to execute and conduct some error checks specific to that operation.
  * @param argc is number of command line arguments
  * @param argv is user input
  * @param im is the user inputted image
  * @param fp is the file pointer to that user inputted image
+ * @param be is the backend that carries out the operation
  */
-int operation(int argc, char *argv[], Image *im, FILE *fp);
+int operation(int argc, char *argv[], Image *im, FILE *fp, const Backend *be);
 
 /* Grayscale NTSC standard
- * function to perform grayscale operation on image.
+ * function to perform grayscale operation on image, rows in parallel.
  * @param im is the user inputted image
  */
 void grayscale(Image *im);
 
 /* Binarize operation
- * function to binarize image using threshold value.
+ * function to binarize image using threshold value, rows in parallel.
  * @param im is the user inputted image
  * @param threshold is the value inputted by user to compare against pixels
  */
 void binarize(Image *im, int threshold);
 
+/* Binarize operation with an automatic threshold
+ * function to binarize image using its Otsu threshold. Luma is computed
+ * once, in the same pass that builds the histogram, and then thresholded.
+ * @param im is the user inputted image
+ * returns 0 on success and 8 if memory could not be allocated
+ */
+int binarizeAuto(Image *im);
+
+/* analyze operation
+ * function to compute the luma histogram, the energy histogram, their
+ * min/max/mean and the Otsu threshold in one parallel pass over the image.
+ * @param im is the user inputted image
+ * @param st receives the statistics
+ * @param lum if not NULL, receives the luma plane (one byte per pixel)
+ * @param withEnergy is nonzero to also compute the energy statistics
+ * returns 0 on success and 8 if memory could not be allocated
+ */
+int analyzeImage(const Image *im, Stats *st, unsigned char *lum, int withEnergy);
+
+/* function to print the statistics computed by analyzeImage, one
+ * "name values..." line per statistic.
+ * @param out is the stream to print to
+ * @param im is the analyzed image
+ * @param st is the statistics
+ */
+void printStats(FILE *out, const Image *im, const Stats *st);
+
+/* function to compute the Otsu threshold of a luma histogram: the
+ * binarize threshold that best separates dark from bright pixels. If all
+ * pixels share one luma there is nothing to separate and it returns 1.
+ * @param hist is the histogram, 256 bins
+ */
+int otsuThreshold(const long long hist[256]);
+
 /* crop operation
  * function to crop image by considering specified co-ordinates.
  * @param im is the user inputted image
@@ -38,12 +129,13 @@ void binarize(Image *im, int threshold);
  * @param y1 row index of top left corner of new output image
  * @param x2 column index of bottom right corner of new output image
  * @param y2 row index of bottom right corner of new output image
- * @param fp file pointer to input ppm file
+ * @param fp file pointer to input ppm file, closed if memory runs out;
+ *        may be NULL outside operation(), and then 8 is just returned
  */
 int crop(Image *im, int x1, int y1, int x2, int y2, FILE *fp);
 
 /* transpose operation
- * function to flip dimension of image.
+ * function to flip dimension of image, copying cache-sized tiles.
  * @param im is the user inputted image
  */
 int transpose(Image *im);
@@ -51,22 +143,20 @@ int transpose(Image *im);
 /* Gradient operation
  * function to compute image gradient (essentially edge detection).
  * @param im is the user inputted image
+ * returns 0 on success and 8 if memory could not be allocated
  */
-void gradient(Image *im);
+int gradient(Image *im);
 
 /* seam operation
  * function to conduct (greedy minimization) seam carving on image iteratively.
+ * Picks the same seams as seamRef, but carves in place and only recomputes
+ * the energy next to each removed seam.
  * @param im is the user inputted image
  * @param scaleCol is the column scale factor
  * @param scaleRow is the row scale factor
+ * returns 0 on success and 8 if memory could not be allocated
  */
-void seam(Image *im, float scaleCol, float scaleRow);
-
-/* helper method to identify the seam to be removed.
- * @param im is the gradient of the user inputted image
- * @param copy is a copy of the original, unedited user inputted image
- */
-void seamCarve(Image *im, Image *copy);
+int seam(Image *im, float scaleCol, float scaleRow);
 
 /* helper method to identify direction of seam.
  * @param argc is number of command line arguments
@@ -83,11 +173,15 @@ int helpAssign(int mid, int right, int left, char position);
  */
 int assignDIR(Image *im, int a, int b);
 
-/* helper method to actually remove an identified seam.
- * @param im is the user inputted image
- * @param seamArr is an array of seams, from which we will use one
- * @param targetIndex is the index of the first pixel of the seam in the image
+/* helper method shared by assignDIR and the optimized seam: given the
+ * energies of the pixel's neighbors on the next row, decide the direction.
+ * @param mid is the energy of the pixel below
+ * @param right is the energy below and to the right (0 near the right edge)
+ * @param left is the energy below and to the left (0 near the left edge)
+ * @param a is the row being inspected
+ * @param b is the column being inspected
+ * @param cols is the number of columns in the image
  */
-void removeSeam(Image *im, int *seamArr, int targetIndex);
+int chooseDIR(int mid, int right, int left, int a, int b, int cols);
 
 #endif // _IMG_PROCESS_H_
@@ -0,0 +1,237 @@
+/*****************************************************************************
+ * Reference backend: the original scalar implementations of the image
+ * processing operations, kept unchanged as the definition of correct output.
+ * The optimized kernels in img_processing.c must match these pixel for
+ * pixel; ./project --verify (make check-perf) checks that they do.
+ *****************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+#include "ppm_io.h"
+#include "img_processing.h"
+#include "img_reference.h"
+
+const Backend refBackend = {"ref", grayscaleRef, binarizeRef, binarizeAutoRef, cropRef, transposeRef, gradientRef, seamRef};
+
+void grayscaleRef(Image *im) {
+
+    unsigned char intensity;
+    for (int r = 0; r < im->rows; r++) {
+        for (int c = 0; c < im->cols; c++) {
+            intensity = 0.3*im->data[(r * im->cols) + c].r + 0.59*im->data[(r * im->cols) + c].g + 0.11*im->data[(r * im->cols) + c].b;
+            //update pixel intensity
+            im->data[(r * im->cols) + c].r = intensity;
+            im->data[(r * im->cols) + c].g = intensity;
+            im->data[(r * im->cols) + c].b = intensity;
+        }
+    }
+}
+
+void binarizeRef(Image *im, int threshold) {
+
+    //intensity will be either 0 or 255 for each pixel
+    unsigned char intensity;
+    for (int r = 0; r < im->rows; r++) {
+        for (int c = 0; c < im->cols; c++) {
+            intensity = 0.3*im->data[(r * im->cols) + c].r + 0.59*im->data[(r * im->cols) + c].g + 0.11*im->data[(r * im->cols) + c].b;
+            if (intensity < threshold) {
+                intensity = 0;
+            } else {intensity = 255;}
+
+            im->data[(r * im->cols) + c].r = intensity;
+            im->data[(r * im->cols) + c].g = intensity;
+            im->data[(r * im->cols) + c].b = intensity;
+        }
+    }
+
+}
+
+int binarizeAutoRef(Image *im) {
+
+    //count pixels of each intensity, then binarize in a second pass
+    long long hist[256] = {0};
+    unsigned char intensity;
+    for (int r = 0; r < im->rows; r++) {
+        for (int c = 0; c < im->cols; c++) {
+            intensity = 0.3*im->data[(r * im->cols) + c].r + 0.59*im->data[(r * im->cols) + c].g + 0.11*im->data[(r * im->cols) + c].b;
+            hist[intensity]++;
+        }
+    }
+
+    binarizeRef(im, otsuThreshold(hist));
+    return 0;
+}
+
+int cropRef(Image *im, int x1, int y1, int x2, int y2, FILE *fp) {
+    //check if memory allocated successfully
+    Pixel *cropPix = malloc(sizeof(Pixel) * (y2 - y1) * (x2 - x1));
+    if (!cropPix) {return fp ? printError(8, fp) : 8;}
+
+    //dimensions of new image
+    int cropRows = y2 - y1;
+    int cropCols = x2 - x1;
+
+    for (int r = 0; r < cropRows; r++) {
+        for (int c = 0; c <cropCols; c++) {
+            cropPix[(r * cropCols) + c] = im->data[((y1 + r) * im->cols) + x1 + c];
+        }
+    }
+
+    free(im->data);
+    im->data = cropPix;
+    im->rows = cropRows;
+    im->cols = cropCols;
+    return -1;
+}
+
+int transposeRef(Image *im) {
+
+    Pixel *transposePix = malloc(sizeof(Pixel) * im->rows * im->cols);
+    //check if memory allocated successfully
+    if (!transposePix) {return 8;}
+    
+    //new(x,y) gets old(y,x)
+    for (int r = 0; r < im->rows; r++) {
+        for (int c = 0; c <im->cols; c++) {
+            transposePix[(c * im->rows) + r] = im->data[(r * im->cols) + c];
+        }
+    }
+
+    //update image
+    free(im->data);
+    im->data = transposePix;
+    int tempRow = im->rows;
+    im->rows = im->cols;
+    im->cols = tempRow;
+    return 0;
+}
+
+int gradientRef(Image *im) {
+    
+    grayscaleRef(im);
+    Pixel *gradPix = malloc(sizeof(Pixel) * im->rows * im->cols);
+    //check if memory allocated successfully
+    if (!gradPix) {return 8;}
+    int gradx;
+    int grady;
+    //grad is absolute sum of gradx and grady
+    int grad;
+
+    for (int r = 0; r < im->rows; r++) {
+        for (int c = 0; c < im->cols; c++) {
+            //boundary pixels get energy zero
+            if (c == 0 || c == (im->cols - 1) || r == 0 || r == (im->rows - 1)) {
+                grad = 0;
+            } else {
+                gradx = (im->data[(r * im->cols) + c + 1].r - im->data[(r * im->cols) + c - 1].r) / 2;
+                grady = (im->data[(r * im->cols) + c + im->cols].r - im->data[(r * im->cols) + c - im->cols].r) / 2;
+                grad = abs(gradx) + abs(grady);
+            }
+            gradPix[(r * im->cols) + c].r = grad;
+            gradPix[(r * im->cols) + c].g = grad;
+            gradPix[(r * im->cols) + c].b = grad;
+        }
+    }
+
+    free(im->data);
+    im->data = gradPix;
+    return 0;
+}
+
+int seamRef(Image *im, float scaleCol, float scaleRow) {
+    Image* copy = malloc(sizeof(Image));
+    copyIm(im, copy);
+
+    int numColRemove = im->cols * (1 - scaleCol);
+    int numRowRemove = im->rows * (1 - scaleRow);
+
+    //minimum output image size should be 2x2
+    if (im->cols - numColRemove < 2) {
+        numColRemove = im->cols - 2;
+    }
+    if (im->rows - numRowRemove < 2) {
+        numRowRemove = im->rows - 2;
+    }
+    //remove columns
+    for (int i = 0; i < numColRemove; i++) {
+        if (gradientRef(im) == 8) {
+            destroy(copy);
+            return 8;
+        }
+        seamCarveRef(im, copy);
+    }
+    
+    transposeRef(im);
+    transposeRef(copy);
+    //now remove rows
+    for (int j = 0; j < numRowRemove; j++) {
+        if (gradientRef(im) == 8) {
+            destroy(copy);
+            return 8;
+        }
+        seamCarveRef(im, copy);
+    }
+    transposeRef(im);
+    
+    destroy(copy);
+    return 0;
+}
+
+void seamCarveRef(Image *im, Image *copy) {
+
+    //for an image with c# columns, create array of size c#. Each element holds cumulative energy of each seam
+    int *seamEnergy = calloc(im->cols, sizeof(int));
+    //2D array. Each row of seamArr contains a seam. The seam is stored as the index of each pixel.
+    int *seamArr = calloc((im->cols * im->rows), sizeof(int));
+    int target;
+    int a = 0;
+    int b = 0;
+    for (b = 0; b < im->cols; b++) {
+        a = 0;
+        seamArr[(b * im->rows)] = b;
+        target = b + assignDIR(im, a, b);
+        for (a = 1; a < im->rows; a++) {
+            seamArr[(b * im->rows) + a] = target;
+            seamEnergy[b] += (int) im->data[(a * im->cols) + target].r;
+            target += assignDIR(im, a, target);
+        }
+    }
+
+    //which seam has the lowest energy?
+    int minEnergyIndex = 0;
+    for (int j = 1; j < im->cols; j++) {
+        if (seamEnergy[j] < seamEnergy[minEnergyIndex]) {minEnergyIndex = j;}
+    }
+
+    //now remove it!
+    removeSeamRef(copy, seamArr, minEnergyIndex);
+
+    //clean up memory
+    free(im->data);
+    copyIm(copy, im);
+
+    free(seamArr);
+    free(seamEnergy);
+}
+
+void removeSeamRef(Image *im, int *seamArr, int targetIndex) {
+
+    targetIndex = im->rows * targetIndex;
+    Pixel *newPix = malloc(sizeof(Pixel) * im->rows * (im->cols - 1));
+    for (int r = 0; r < im->rows; r++) {
+        for (int c = 0; c < im->cols - 1; c++) {
+            //do not copy if current element is pixel that is to be removed
+            if (c < seamArr[targetIndex]) {
+                newPix[(r * (im->cols - 1)) + c] = im->data[(r * im->cols) + c];
+            } else {
+                newPix[(r * (im->cols - 1)) + c] = im->data[(r * im->cols) + c + 1];
+            }
+        }
+            targetIndex += 1;
+    }
+    // output image has one less column
+    im->cols -= 1;
+    
+    free(im->data);
+    im->data = newPix;
+    
+}
@@ -0,0 +1,68 @@
+#ifndef _IMG_REFERENCE_H_
+#define _IMG_REFERENCE_H_
+#include <stdio.h>
+#include "img_processing.h"
+
+/* The reference backend, selected with --backend ref */
+extern const Backend refBackend;
+
+/* reference grayscale operation (NTSC standard).
+ * @param im is the user inputted image
+ */
+void grayscaleRef(Image *im);
+
+/* reference binarize operation.
+ * @param im is the user inputted image
+ * @param threshold is the value inputted by user to compare against pixels
+ */
+void binarizeRef(Image *im, int threshold);
+
+/* reference binarize with the Otsu threshold: histogram pass, then binarizeRef.
+ * @param im is the user inputted image
+ */
+int binarizeAutoRef(Image *im);
+
+/* reference crop operation.
+ * @param im is the user inputted image
+ * @param x1 column index of top left corner of new output image
+ * @param y1 row index of top left corner of new output image
+ * @param x2 column index of bottom right corner of new output image
+ * @param y2 row index of bottom right corner of new output image
+ * @param fp file pointer to input ppm file, closed if memory runs out;
+ *        may be NULL outside operation(), and then 8 is just returned
+ */
+int cropRef(Image *im, int x1, int y1, int x2, int y2, FILE *fp);
+
+/* reference transpose operation.
+ * @param im is the user inputted image
+ */
+int transposeRef(Image *im);
+
+/* reference gradient operation.
+ * @param im is the user inputted image
+ * returns 0 on success and 8 if memory could not be allocated
+ */
+int gradientRef(Image *im);
+
+/* reference seam operation (greedy minimization seam carving).
+ * @param im is the user inputted image
+ * @param scaleCol is the column scale factor
+ * @param scaleRow is the row scale factor
+ * returns 0 on success and 8 if memory could not be allocated
+ */
+int seamRef(Image *im, float scaleCol, float scaleRow);
+
+/* helper method to identify the seam to be removed.
+ * @param im is the gradient of the user inputted image
+ * @param copy is a copy of the original, unedited user inputted image
+ */
+void seamCarveRef(Image *im, Image *copy);
+
+/* helper method to actually remove an identified seam.
+ * @param im is the user inputted image
+ * @param seamArr is an array of seams, from which we will use one
+ * @param targetIndex is the index of the first pixel of the seam in the image
+ */
+void removeSeamRef(Image *im, int *seamArr, int targetIndex);
+
+#endif // _IMG_REFERENCE_H_
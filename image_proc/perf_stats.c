@@ -0,0 +1,165 @@
+#define _GNU_SOURCE // syscall, getrusage and clock_gettime under -std=c99
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+#include "perf_stats.h"
+
+#ifdef __linux__
+/* open one counter for this process and the threads it creates later;
+ * userOnly leaves out kernel mode, which unprivileged users may not count
+ */
+static int openEvent(unsigned type, unsigned long long config, int userOnly) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.exclude_kernel = userOnly;
+    attr.exclude_hv = 1;
+    attr.inherit = 1;
+    //needed to scale counts if the PMU multiplexes our events
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+/* cache event config: last-level cache or data TLB read misses */
+static unsigned long long cacheMiss(unsigned long long cache) {
+    return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+#endif
+
+PerfCounters* perfOpen(void) {
+    PerfCounters *pc = malloc(sizeof(PerfCounters));
+    if (!pc) {return NULL;}
+    for (int i = 0; i < PERF_NUM_EVENTS; i++) {
+        pc->fd[i] = -1;
+    }
+
+    pc->userOnly = 0;
+
+#ifdef __linux__
+    //count kernel mode too, so the work read() and write() do is included;
+    //fall back to user space only, which the default perf_event_paranoid
+    //level always allows
+    pc->fd[PERF_CYCLES] = openEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, 0);
+    if (pc->fd[PERF_CYCLES] == -1) {
+        pc->userOnly = 1;
+        pc->fd[PERF_CYCLES] = openEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, 1);
+    }
+    //the other hardware events use the same mode, so the ratios stay meaningful
+    pc->fd[PERF_INSTRUCTIONS] = openEvent(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, pc->userOnly);
+    pc->fd[PERF_LLC_MISSES] = openEvent(PERF_TYPE_HW_CACHE, cacheMiss(PERF_COUNT_HW_CACHE_LL), pc->userOnly);
+    pc->fd[PERF_DTLB_MISSES] = openEvent(PERF_TYPE_HW_CACHE, cacheMiss(PERF_COUNT_HW_CACHE_DTLB), pc->userOnly);
+    //faults taken inside read() and write() happen in kernel mode; if those
+    //cannot be counted, the report uses rusage, which sees every fault
+    pc->fd[PERF_PAGE_FAULTS] = openEvent(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS, 0);
+#endif
+
+    pc->hw = (pc->fd[PERF_CYCLES] != -1) && (pc->fd[PERF_INSTRUCTIONS] != -1);
+    return pc;
+}
+
+/* read one counter, scaled up if it was only scheduled part of the time */
+static long long readEvent(int fd) {
+    unsigned long long buf[3]; // value, time enabled, time running
+    if (fd == -1 || read(fd, buf, sizeof(buf)) != (ssize_t) sizeof(buf)) {return -1;}
+    if (buf[2] == 0) {return 0;}
+    if (buf[2] < buf[1]) {return (long long) ((double) buf[0] * buf[1] / buf[2]);}
+    return (long long) buf[0];
+}
+
+static void takeSample(const PerfCounters *pc, PerfSample *s) {
+    for (int i = 0; i < PERF_NUM_EVENTS; i++) {
+        s->value[i] = readEvent(pc->fd[i]);
+    }
+
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    s->user = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6;
+    s->sys = ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+    s->faults = ru.ru_minflt + ru.ru_majflt;
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    s->wall = ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void perfStart(const PerfCounters *pc, PerfStage *stage, const char *name) {
+    if (!pc) {return;}
+    stage->name = name;
+    stage->bytes = 0;
+    takeSample(pc, &stage->start);
+}
+
+void perfStop(const PerfCounters *pc, PerfStage *stage, long long bytes) {
+    if (!pc) {return;}
+    takeSample(pc, &stage->end);
+    stage->bytes = bytes;
+}
+
+/* difference of one event over a stage, -1 if it was not counted */
+static long long delta(const PerfStage *s, int event) {
+    if (s->start.value[event] < 0 || s->end.value[event] < 0) {return -1;}
+    return s->end.value[event] - s->start.value[event];
+}
+
+/* print a count, or n/a for events that were not counted */
+static void printCount(FILE *out, long long v, int width) {
+    if (v < 0) {
+        fprintf(out, " %*s", width, "n/a");
+    } else {fprintf(out, " %*lld", width, v);}
+}
+
+void perfReport(FILE *out, const PerfCounters *pc, const PerfStage *stages, int n) {
+    if (!pc) {return;}
+
+    if (pc->hw) {
+        fprintf(out, "perf: hardware counters (%s, all threads)\n",
+                pc->userOnly ? "user space only" : "user and kernel space");
+        fprintf(out, "%-12s %10s %14s %14s %6s %12s %12s %10s %11s %9s\n", "stage", "wall_ms", "cycles",
+                "instructions", "IPC", "llc_misses", "dtlb_misses", "faults", "bytes/cyc", "GB/s");
+    } else {
+        fprintf(out, "perf: hardware counters unavailable, falling back to rusage\n");
+        fprintf(out, "%-12s %10s %10s %10s %10s %9s\n", "stage", "wall_ms", "user_ms", "sys_ms", "faults", "GB/s");
+    }
+
+    for (int i = 0; i < n; i++) {
+        const PerfStage *s = &stages[i];
+        double wall = s->end.wall - s->start.wall;
+        double gbps = (wall > 0) ? s->bytes / wall / 1e9 : 0;
+        long long faults = delta(s, PERF_PAGE_FAULTS);
+        //rusage always knows the page faults, even without counters
+        if (faults < 0) {faults = s->end.faults - s->start.faults;}
+
+        if (pc->hw) {
+            long long cycles = delta(s, PERF_CYCLES), instructions = delta(s, PERF_INSTRUCTIONS);
+            fprintf(out, "%-12s %10.3f", s->name, wall * 1e3);
+            printCount(out, cycles, 14);
+            printCount(out, instructions, 14);
+            fprintf(out, " %6.2f", (cycles > 0) ? (double) instructions / cycles : 0.0);
+            printCount(out, delta(s, PERF_LLC_MISSES), 12);
+            printCount(out, delta(s, PERF_DTLB_MISSES), 12);
+            printCount(out, faults, 10);
+            fprintf(out, " %11.3f %9.3f\n", (cycles > 0) ? (double) s->bytes / cycles : 0.0, gbps);
+        } else {
+            fprintf(out, "%-12s %10.3f %10.3f %10.3f", s->name, wall * 1e3,
+                    (s->end.user - s->start.user) * 1e3, (s->end.sys - s->start.sys) * 1e3);
+            printCount(out, faults, 10);
+            fprintf(out, " %9.3f\n", gbps);
+        }
+    }
+}
+
+void perfClose(PerfCounters *pc) {
+    if (!pc) {return;}
+    for (int i = 0; i < PERF_NUM_EVENTS; i++) {
+        if (pc->fd[i] != -1) {close(pc->fd[i]);}
+    }
+    free(pc);
+}
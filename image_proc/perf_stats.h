@@ -0,0 +1,78 @@
+#ifndef _PERF_STATS_H_
+#define _PERF_STATS_H_
+#include <stdio.h>
+
+/* events counted per stage when hardware counters are available */
+enum {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_LLC_MISSES,
+    PERF_DTLB_MISSES,
+    PERF_PAGE_FAULTS,
+    PERF_NUM_EVENTS
+};
+
+/* A struct to hold the counter file descriptors for the whole run.
+ * Counters are opened once, before any worker threads exist, and inherit
+ * into them; stages are measured as differences between two samples.
+ */
+typedef struct _perfCounters {
+    int fd[PERF_NUM_EVENTS]; // -1 for events that could not be opened
+    int hw;                  // nonzero if cycles and instructions are counted
+    int userOnly;            // nonzero if hardware events leave out kernel mode
+} PerfCounters;
+
+/* A struct to hold one reading of every counter plus the rusage metrics
+ * that are always available.
+ */
+typedef struct _perfSample {
+    long long value[PERF_NUM_EVENTS]; // scaled counter values, -1 if unavailable
+    double wall;                      // monotonic wall clock, seconds
+    double user;                      // user CPU time, seconds
+    double sys;                       // system CPU time, seconds
+    long faults;                      // minor + major page faults from rusage
+} PerfSample;
+
+/* A struct to hold the measurements of one stage of the program */
+typedef struct _perfStage {
+    const char *name;  // stage name, e.g. "read" or the operation name
+    long long bytes;   // bytes of pixel data read and written by the stage
+    PerfSample start;
+    PerfSample end;
+} PerfStage;
+
+/* function to open the counters. Hardware events count user and kernel
+ * mode if the kernel allows it, and user mode only otherwise. Never fails:
+ * events the kernel refuses (no PMU, perf_event_paranoid, seccomp) are
+ * left out, and the report falls back to rusage metrics.
+ * returns the heap-allocated counters, or NULL if out of memory
+ */
+PerfCounters* perfOpen(void);
+
+/* function to start measuring a stage; does nothing if pc is NULL.
+ * @param pc is the open counters
+ * @param stage is the stage to fill in
+ * @param name is the stage name shown in the report
+ */
+void perfStart(const PerfCounters *pc, PerfStage *stage, const char *name);
+
+/* function to finish measuring a stage; does nothing if pc is NULL.
+ * @param pc is the open counters
+ * @param stage is the stage started by perfStart
+ * @param bytes is the number of pixel bytes the stage read and wrote
+ */
+void perfStop(const PerfCounters *pc, PerfStage *stage, long long bytes);
+
+/* function to print one line per stage with raw counts and derived
+ * IPC and bytes per cycle; does nothing if pc is NULL.
+ * @param out is the stream to print to
+ * @param pc is the open counters
+ * @param stages is the array of finished stages
+ * @param n is the number of stages
+ */
+void perfReport(FILE *out, const PerfCounters *pc, const PerfStage *stages, int n);
+
+/* function to close the counters and free pc (NULL is allowed) */
+void perfClose(PerfCounters *pc);
+
+#endif // _PERF_STATS_H_
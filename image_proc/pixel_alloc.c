@@ -0,0 +1,59 @@
+#define _GNU_SOURCE // posix_memalign and madvise under -std=c99
+#include <stdlib.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "pixel_alloc.h"
+
+//size of a transparent huge page on x86-64 and arm64 with 4K base pages
+#define HUGE_PAGE_SIZE (2UL * 1024 * 1024)
+
+static AllocPolicy policy = ALLOC_HUGE;
+
+void setAllocPolicy(AllocPolicy p) {
+    policy = p;
+}
+
+AllocPolicy getAllocPolicy(void) {
+    return policy;
+}
+
+#ifdef _OPENMP
+/* touch one byte per page of every row, rows split across threads the
+ * same way the row-parallel kernels split them
+ */
+static void firstTouch(char *buf, int rows, size_t rowBytes) {
+    size_t page = (size_t) sysconf(_SC_PAGESIZE);
+    #pragma omp parallel for schedule(static)
+    for (int r = 0; r < rows; r++) {
+        char *row = buf + ((size_t) r * rowBytes);
+        for (size_t off = 0; off < rowBytes; off += page) {
+            row[off] = 0;
+        }
+    }
+}
+#endif
+
+void* allocRows(int rows, size_t rowBytes) {
+    size_t bytes = (size_t) rows * rowBytes;
+    if (policy == ALLOC_PLAIN || bytes < ALLOC_HUGE_THRESHOLD) {return malloc(bytes);}
+
+    //round up to whole huge pages so the advice covers only our buffer
+    size_t rounded = (bytes + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+    void *buf = NULL;
+    if (posix_memalign(&buf, HUGE_PAGE_SIZE, rounded) != 0) {return NULL;}
+#ifdef MADV_HUGEPAGE
+    //only advice: if THP is disabled the buffer simply keeps 4K pages
+    madvise(buf, rounded, MADV_HUGEPAGE);
+#endif
+
+#ifdef _OPENMP
+    //with one thread, the first real write places pages just as well
+    if (omp_get_max_threads() > 1) {firstTouch(buf, rows, rowBytes);}
+#endif
+    return buf;
+}
@@ -0,0 +1,35 @@
+#ifndef _PIXEL_ALLOC_H_
+#define _PIXEL_ALLOC_H_
+#include <stddef.h>
+
+//buffers smaller than this stay on plain malloc; a couple of huge pages is
+//where the TLB savings start to outweigh the rounding waste
+#define ALLOC_HUGE_THRESHOLD (4UL * 1024 * 1024)
+
+/* allocation policies for pixel buffers */
+typedef enum _allocPolicy {
+    ALLOC_PLAIN,  // plain malloc
+    ALLOC_HUGE    // huge pages above a threshold, plus parallel first-touch (default)
+} AllocPolicy;
+
+/* function to select the policy used by every later allocRows call.
+ * @param policy is the new policy
+ */
+void setAllocPolicy(AllocPolicy policy);
+
+/* function to get the current allocation policy */
+AllocPolicy getAllocPolicy(void);
+
+/* function to allocate an image-shaped buffer of rows rows of rowBytes
+ * bytes each. With ALLOC_HUGE, buffers above ALLOC_HUGE_THRESHOLD are
+ * aligned to and advised for transparent huge pages, and each thread
+ * first-touches the band of rows it gets under schedule(static), so on
+ * NUMA machines those pages land on that thread's node. The buffer is
+ * released with free(), like any malloc'd one.
+ * @param rows is the number of rows
+ * @param rowBytes is the size of one row in bytes
+ * returns the buffer, or NULL if out of memory
+ */
+void* allocRows(int rows, size_t rowBytes);
+
+#endif // _PIXEL_ALLOC_H_
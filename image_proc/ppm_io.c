@@ -9,6 +9,7 @@
  * Summary: This file implements the utility functions to read/write PPM file
  *****************************************************************************/
 #include "ppm_io.h" // PPM I/O header
+#include "pixel_alloc.h" // allocRows
 #include <stdlib.h> // c functions: malloc, free
 #include <assert.h> // c functions: assert
 #include <string.h> // c functions: strncmp, memcpy
@@ -43,21 +44,15 @@ int ReadNum(FILE *fp) {
   }
 }
 
-/* ReadPPM
- * Read a PPM-formatted image from a file (assumes fp != NULL).
- * Returns the address of the heap-allocated Image struct it
- * creates and populates with the Image data.
+/* ReadPPMHeader
+ * Read the P6 tag, dimensions and color depth from a PPM file
+ * (assumes fp != NULL and im != NULL), leaving fp at the first
+ * byte of pixel data. Returns 0 on success and -1 on failure.
  */
-Image* ReadPPM(FILE *fp) {
-  // check that fp is not NULL
+int ReadPPMHeader(FILE *fp, Image *im) {
+  // check that fp and im are not NULL
   assert(fp);
-
-  // allocate image (but not space to hold pixels -- yet)
-  Image *im = malloc(sizeof(Image));
-  if (!im) {
-    fprintf(stderr, "Error:ppm_io - failed to allocate memory for image!\n");
-    return NULL;
-  }
+  assert(im);
 
   // initialize fields to error codes, in case we have to bail out early
   im->rows = im->cols = -1;
@@ -69,8 +64,7 @@ Image* ReadPPM(FILE *fp) {
   //printf("%sz\n", tag);
   if (strncmp(tag, "P6", 20)) {
     fprintf(stderr, "Error:ppm_io - not a PPM (bad tag)\n");
-    free(im);
-    return NULL;
+    return -1;
   }
 
   /* read image dimensions */ 
@@ -83,19 +77,41 @@ Image* ReadPPM(FILE *fp) {
   int colors = ReadNum(fp);
   if (colors != 255) {
     fprintf(stderr, "Error:ppm_io - PPM file with colors different from 255\n");
-    free(im);
-    return NULL;
+    return -1;
   }
 
   //confirm that dimensions are positive
   if (im->cols <= 0 || im->rows <= 0) {
     fprintf(stderr, "Error:ppm_io - PPM file with non-positive dimensions\n");
+    return -1;
+  }
+
+  return 0;
+}
+
+/* ReadPPM
+ * Read a PPM-formatted image from a file (assumes fp != NULL).
+ * Returns the address of the heap-allocated Image struct it
+ * creates and populates with the Image data.
+ */
+Image* ReadPPM(FILE *fp) {
+  // check that fp is not NULL
+  assert(fp);
+
+  // allocate image (but not space to hold pixels -- yet)
+  Image *im = malloc(sizeof(Image));
+  if (!im) {
+    fprintf(stderr, "Error:ppm_io - failed to allocate memory for image!\n");
+    return NULL;
+  }
+
+  if (ReadPPMHeader(fp, im) == -1) {
     free(im);
     return NULL;
   }
 
   // allocate the right amount of space for the Pixels
-  im->data = malloc(sizeof(Pixel) * (im->rows) * (im->cols));
+  im->data = allocRows(im->rows, sizeof(Pixel) * (im->cols));
 
   if (!im->data) {
     fprintf(stderr, "Error:ppm_io - failed to allocate memory for image pixels!\n");
@@ -41,6 +41,13 @@ typedef struct _image {
   int cols;     // number of columns of Pixels
 } Image;
 
+/* ReadPPMHeader
+ * Read the header of a PPM-formatted image (assumes fp != NULL),
+ * filling in im->rows and im->cols but not im->data. Leaves fp
+ * positioned at the pixel data; returns 0 on success, -1 on failure.
+ */
+int ReadPPMHeader(FILE *fp, Image *im);
+
 /* ReadPPM
  * Read a PPM-formatted image from a file (assumes fp != NULL).
  * Returns the address of the heap-allocated Image struct it
@@ -1,7 +1,20 @@
 /*****************************************************************************
  * This file implements a program for image processing operations.
  *          Different operations take different input arguments. In general,
- *            ./project <input> <output> <operation name> [operation params]
+ *            ./project <input> <output> [options] <operation name> [operation params]
+ *          Options:
+ *            --thumb <cols> <rows> <box|bilinear>: resize while decoding the
+ *              input, before the operation runs (0 keeps the aspect ratio)
+ *            --perf: report hardware counters (or rusage metrics) for reading,
+ *              the operation and writing on stderr
+ *            --backend <fast|ref>: run the optimized kernels (default) or the
+ *              original scalar reference implementations
+ *            --alloc <huge|plain>: allocate large pixel buffers on huge pages
+ *              with per-thread first-touch (default), or with plain malloc
+ *          ./project --verify [seed] compares both backends on generated images
+ *          and returns 8 if any output differs (make check-perf runs it).
+ *          ./project --bench [cols rows] times the allocating kernels under both
+ *          allocation policies (make bench runs it).
  *          The program will return 0 and write an output file if successful.
  *          Otherwise, the below error codes should be returned:
  *            1: Wrong usage (i.e. mandatory arguments are not provided)
@@ -0,0 +1,369 @@
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <assert.h>
+#include "ppm_io.h"
+#include "resize.h"
+#include "pixel_alloc.h"
+
+/* Horizontal sampling positions, computed once and shared by every row.
+ * Box rows are resampled vertically first: the source rows of the span are
+ * summed channel by channel (accumulateSource), then the column sums are
+ * reduced to outCols pixels once (boxReduce). Bilinear rows are reduced to
+ * outCols pixels first (reduceRow), then two reduced rows are blended.
+ * Neither filter rounds before the final division, so the order does not
+ * change the result. Both the in-memory and the decode-time path use the
+ * same steps, so they produce identical pixels.
+ */
+typedef struct _plan {
+    Filter filter;
+    int inCols;
+    int inRows;
+    int outCols;
+    int outRows;
+    int *x0;   // first source column of each output column
+    int *x1;   // box: one past the last source column; bilinear: second tap
+    int *fx;   // bilinear: weight of the second tap, out of 256
+} Plan;
+
+/* Two-slot cache of reduced rows for the decode-time bilinear path.
+ * Source rows can only be read from the file in order, and both filters
+ * ask for rows in non-decreasing order, so two slots are enough.
+ */
+typedef struct _rowCache {
+    FILE *fp;
+    Pixel *raw;       // one undecoded source row
+    unsigned *h[2];   // horizontally reduced rows
+    int row[2];       // source row held by each slot, -1 if empty
+    int next;         // index of the next source row in the file
+} RowCache;
+
+int parseFilter(const char *name, Filter *filter) {
+    if (!strcmp(name, "box")) {
+        *filter = FILTER_BOX;
+    } else if (!strcmp(name, "bilinear")) {
+        *filter = FILTER_BILINEAR;
+    } else {return -1;}
+    return 0;
+}
+
+int fitDims(int inCols, int inRows, int *outCols, int *outRows) {
+    if (*outCols < 0 || *outRows < 0 || (*outCols == 0 && *outRows == 0)) {return -1;}
+
+    long long cols = *outCols, rows = *outRows;
+    //derive the missing dimension, rounding to nearest and keeping at least 1
+    if (cols == 0) {
+        cols = ((long long) inCols * rows + inRows / 2) / inRows;
+        if (cols < 1) {cols = 1;}
+    }
+    if (rows == 0) {
+        rows = ((long long) inRows * cols + inCols / 2) / inCols;
+        if (rows < 1) {rows = 1;}
+    }
+    //pixel indices are ints, so the output must stay addressable
+    if (cols * rows > INT_MAX / 3) {return -1;}
+
+    *outCols = (int) cols;
+    *outRows = (int) rows;
+    return 0;
+}
+
+/* source span [lo, hi) covered by output index o; never empty */
+static void boxSpan(int o, int in, int out, int *lo, int *hi) {
+    *lo = (int) ((long long) o * in / out);
+    *hi = (int) ((long long) (o + 1) * in / out);
+    if (*hi <= *lo) {*hi = *lo + 1;}
+}
+
+/* two source taps around the centre of output index o, and the weight
+ * (out of 256) of the second one
+ */
+static void bilinearTaps(int o, int in, int out, int *t0, int *t1, int *f) {
+    //centre of output pixel o in source coordinates, in 1/256 steps
+    long long pos = ((2LL * o + 1) * in * 256) / (2LL * out) - 128;
+    if (pos < 0) {pos = 0;}
+    *t0 = (int) (pos >> 8);
+    *f = (int) (pos & 255);
+    if (*t0 >= in - 1) {
+        *t0 = in - 1;
+        *f = 0;
+    }
+    *t1 = (*t0 < in - 1) ? *t0 + 1 : *t0;
+}
+
+static void planFree(Plan *p) {
+    free(p->x0);
+    free(p->x1);
+    free(p->fx);
+}
+
+static int planInit(Plan *p, int inCols, int inRows, int outCols, int outRows, Filter filter) {
+    p->filter = filter;
+    p->inCols = inCols;
+    p->inRows = inRows;
+    p->outCols = outCols;
+    p->outRows = outRows;
+    p->x0 = malloc(sizeof(int) * outCols);
+    p->x1 = malloc(sizeof(int) * outCols);
+    p->fx = malloc(sizeof(int) * outCols);
+    if (!p->x0 || !p->x1 || !p->fx) {
+        planFree(p);
+        return -1;
+    }
+
+    for (int c = 0; c < outCols; c++) {
+        if (filter == FILTER_BOX) {
+            boxSpan(c, inCols, outCols, &p->x0[c], &p->x1[c]);
+            p->fx[c] = 0;
+        } else {
+            bilinearTaps(c, inCols, outCols, &p->x0[c], &p->x1[c], &p->fx[c]);
+        }
+    }
+    return 0;
+}
+
+/* reduce one source row to outCols bilinear pixels, one unsigned per
+ * channel, scaled by 256. The two taps are a gather, so this stays scalar.
+ */
+static void reduceRow(const Plan *p, const Pixel *src, unsigned *h) {
+    for (int c = 0; c < p->outCols; c++) {
+        const Pixel *a = &src[p->x0[c]], *b = &src[p->x1[c]];
+        unsigned w1 = p->fx[c], w0 = 256 - w1;
+        h[(3 * c)] = a->r * w0 + b->r * w1;
+        h[(3 * c) + 1] = a->g * w0 + b->g * w1;
+        h[(3 * c) + 2] = a->b * w0 + b->b * w1;
+    }
+}
+
+/* colAcc += src over one source row viewed as n channel bytes
+ * (Pixel is three packed bytes, as ReadPPM assumes)
+ */
+static void accumulateSource(unsigned long long *colAcc, const unsigned char *src, int n) {
+    #pragma omp simd
+    for (int i = 0; i < n; i++) {
+        colAcc[i] += src[i];
+    }
+}
+
+/* sum the column sums over each output span and divide by its area,
+ * rounding to nearest
+ */
+static void boxReduce(const Plan *p, const unsigned long long *colAcc, int spanRows, Pixel *out) {
+    for (int c = 0; c < p->outCols; c++) {
+        unsigned long long r = 0, g = 0, b = 0;
+        for (int x = p->x0[c]; x < p->x1[c]; x++) {
+            r += colAcc[(3 * x)];
+            g += colAcc[(3 * x) + 1];
+            b += colAcc[(3 * x) + 2];
+        }
+        unsigned long long area = (unsigned long long) (p->x1[c] - p->x0[c]) * spanRows;
+        out[c].r = (unsigned char) ((r + area / 2) / area);
+        out[c].g = (unsigned char) ((g + area / 2) / area);
+        out[c].b = (unsigned char) ((b + area / 2) / area);
+    }
+}
+
+/* vertical bilinear blend of two reduced rows; out is the output row
+ * viewed as n channel bytes (Pixel is three packed bytes, as ReadPPM assumes)
+ */
+static void blendRows(const unsigned *h0, const unsigned *h1, int fy, int n, unsigned char *out) {
+    unsigned w1 = fy, w0 = 256 - fy;
+    #pragma omp simd
+    for (int i = 0; i < n; i++) {
+        out[i] = (unsigned char) ((h0[i] * w0 + h1[i] * w1 + 32768) >> 16);
+    }
+}
+
+/* compute output row oy from an image held in memory; box uses colAcc
+ * (inCols * 3 sums), bilinear uses h0 and h1 (outCols * 3 each)
+ */
+static void resizeRow(const Plan *p, const Pixel *src, int oy, unsigned *h0, unsigned *h1,
+                      unsigned long long *colAcc, Pixel *out) {
+    int n = p->outCols * 3;
+    if (p->filter == FILTER_BOX) {
+        int y0, y1;
+        boxSpan(oy, p->inRows, p->outRows, &y0, &y1);
+        memset(colAcc, 0, sizeof(unsigned long long) * p->inCols * 3);
+        for (int y = y0; y < y1; y++) {
+            accumulateSource(colAcc, (const unsigned char *) &src[y * p->inCols], p->inCols * 3);
+        }
+        boxReduce(p, colAcc, y1 - y0, out);
+    } else {
+        int t0, t1, fy;
+        bilinearTaps(oy, p->inRows, p->outRows, &t0, &t1, &fy);
+        reduceRow(p, &src[t0 * p->inCols], h0);
+        reduceRow(p, &src[t1 * p->inCols], h1);
+        blendRows(h0, h1, fy, n, (unsigned char *) out);
+    }
+}
+
+int resize(Image *im, int outCols, int outRows, Filter filter) {
+    Plan p;
+    if (planInit(&p, im->cols, im->rows, outCols, outRows, filter) == -1) {return 8;}
+
+    Pixel *resizePix = allocRows(outRows, sizeof(Pixel) * outCols);
+    //check if memory allocated successfully
+    if (!resizePix) {
+        planFree(&p);
+        return 8;
+    }
+
+    int n = outCols * 3;
+    int failed = 0;
+    #pragma omp parallel
+    {
+        //every thread reduces rows into its own scratch buffers
+        unsigned *h0 = malloc(sizeof(unsigned) * n);
+        unsigned *h1 = malloc(sizeof(unsigned) * n);
+        unsigned long long *colAcc = malloc(sizeof(unsigned long long) * im->cols * 3);
+        if (!h0 || !h1 || !colAcc) {
+            #pragma omp atomic write
+            failed = 1;
+        }
+
+        #pragma omp for schedule(static)
+        for (int r = 0; r < outRows; r++) {
+            if (h0 && h1 && colAcc) {
+                resizeRow(&p, im->data, r, h0, h1, colAcc, &resizePix[r * outCols]);
+            }
+        }
+
+        free(h0);
+        free(h1);
+        free(colAcc);
+    }
+    planFree(&p);
+
+    if (failed) {
+        free(resizePix);
+        return 8;
+    }
+
+    //update image
+    free(im->data);
+    im->data = resizePix;
+    im->rows = outRows;
+    im->cols = outCols;
+    return 0;
+}
+
+/* read forward through the file until source row y sits in raw; rows
+ * in between are decoded and dropped. Returns -1 if the file ends early
+ * or row y has already gone by.
+ */
+static int readRow(RowCache *rc, const Plan *p, int y) {
+    while (rc->next <= y) {
+        if ((int) fread(rc->raw, sizeof(Pixel), p->inCols, rc->fp) != p->inCols) {return -1;}
+        rc->next++;
+    }
+    return (rc->next - 1 == y) ? 0 : -1;
+}
+
+/* return the cache slot holding reduced source row y, reading forward
+ * through the file as needed; slot keep is never evicted. Returns -1 if
+ * the file ends early.
+ */
+static int fetchRow(RowCache *rc, const Plan *p, int y, int keep) {
+    for (int s = 0; s < 2; s++) {
+        if (rc->row[s] == y) {return s;}
+    }
+
+    //evict the slot holding the older row, unless it must be kept
+    int slot;
+    if (keep == 0) {
+        slot = 1;
+    } else if (keep == 1) {
+        slot = 0;
+    } else {slot = (rc->row[0] <= rc->row[1]) ? 0 : 1;}
+
+    if (readRow(rc, p, y) == -1) {return -1;}
+    reduceRow(p, rc->raw, rc->h[slot]);
+    rc->row[slot] = y;
+    return slot;
+}
+
+Image* ReadPPMResized(FILE *fp, int outCols, int outRows, Filter filter) {
+    // check that fp is not NULL
+    assert(fp);
+
+    Image *im = malloc(sizeof(Image));
+    if (!im) {
+        fprintf(stderr, "Error:resize - failed to allocate memory for image!\n");
+        return NULL;
+    }
+    if (ReadPPMHeader(fp, im) == -1) {
+        free(im);
+        return NULL;
+    }
+    if (fitDims(im->cols, im->rows, &outCols, &outRows) == -1) {
+        fprintf(stderr, "Error:resize - unusable output dimensions %dx%d\n", outCols, outRows);
+        free(im);
+        return NULL;
+    }
+
+    Plan p;
+    if (planInit(&p, im->cols, im->rows, outCols, outRows, filter) == -1) {
+        fprintf(stderr, "Error:resize - failed to allocate memory for resampling!\n");
+        free(im);
+        return NULL;
+    }
+
+    int n = outCols * 3;
+    RowCache rc;
+    rc.fp = fp;
+    rc.raw = malloc(sizeof(Pixel) * im->cols);
+    rc.h[0] = malloc(sizeof(unsigned) * n);
+    rc.h[1] = malloc(sizeof(unsigned) * n);
+    rc.row[0] = rc.row[1] = -1;
+    rc.next = 0;
+    unsigned long long *colAcc = malloc(sizeof(unsigned long long) * im->cols * 3);
+    int accRows[2] = {-1, -1}; // source span [lo, hi) summed in colAcc
+    im->data = allocRows(outRows, sizeof(Pixel) * outCols);
+
+    int ok = rc.raw && rc.h[0] && rc.h[1] && colAcc && im->data;
+    if (!ok) {fprintf(stderr, "Error:resize - failed to allocate memory for image pixels!\n");}
+
+    for (int r = 0; ok && r < outRows; r++) {
+        Pixel *out = &im->data[r * outCols];
+        if (filter == FILTER_BOX) {
+            int y0, y1;
+            boxSpan(r, p.inRows, outRows, &y0, &y1);
+            //when upscaling, consecutive output rows share a span; spans
+            //otherwise start after the previous one, so rows are read in order
+            if (y0 != accRows[0] || y1 != accRows[1]) {
+                memset(colAcc, 0, sizeof(unsigned long long) * im->cols * 3);
+                for (int y = y0; ok && y < y1; y++) {
+                    if (readRow(&rc, &p, y) == -1) {
+                        ok = 0;
+                    } else {accumulateSource(colAcc, (const unsigned char *) rc.raw, im->cols * 3);}
+                }
+                accRows[0] = y0;
+                accRows[1] = y1;
+            }
+            if (ok) {boxReduce(&p, colAcc, y1 - y0, out);}
+        } else {
+            int t0, t1, fy;
+            bilinearTaps(r, p.inRows, outRows, &t0, &t1, &fy);
+            int s0 = fetchRow(&rc, &p, t0, -1);
+            int s1 = (s0 == -1) ? -1 : fetchRow(&rc, &p, t1, s0);
+            if (s1 == -1) {
+                ok = 0;
+            } else {blendRows(rc.h[s0], rc.h[s1], fy, n, (unsigned char *) out);}
+        }
+        if (!ok) {fprintf(stderr, "Error:resize - failed to read data from file with %d rows\n", p.inRows);}
+    }
+
+    free(colAcc);
+    free(rc.h[0]);
+    free(rc.h[1]);
+    free(rc.raw);
+    planFree(&p);
+
+    if (!ok) {
+        destroy(im);
+        return NULL;
+    }
+    im->rows = outRows;
+    im->cols = outCols;
+    return im;
+}
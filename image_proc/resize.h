@@ -0,0 +1,52 @@
+#ifndef _RESIZE_H_
+#define _RESIZE_H_
+#include <stdio.h>
+#include "ppm_io.h"
+
+/* Resampling filters shared by the resize operation and the
+ * decode-time thumbnail path.
+ */
+typedef enum _filter {
+    FILTER_BOX,      // average of every source pixel covered by the output pixel
+    FILTER_BILINEAR  // weighted blend of the 2x2 nearest source pixels
+} Filter;
+
+/* function to translate a filter name given on the command line.
+ * @param name is "box" or "bilinear"
+ * @param filter receives the matching filter
+ * returns 0 on success and -1 if the name is unknown
+ */
+int parseFilter(const char *name, Filter *filter);
+
+/* function to complete requested output dimensions. A zero dimension
+ * is derived from the other one so the aspect ratio is preserved.
+ * @param inCols is the column count of the source image
+ * @param inRows is the row count of the source image
+ * @param outCols is the requested column count, updated in place
+ * @param outRows is the requested row count, updated in place
+ * returns 0 on success and -1 if the dimensions are unusable
+ */
+int fitDims(int inCols, int inRows, int *outCols, int *outRows);
+
+/* resize operation
+ * function to resample an image to new dimensions. Output rows are
+ * computed in parallel.
+ * @param im is the user inputted image
+ * @param outCols is the column count of the output image
+ * @param outRows is the row count of the output image
+ * @param filter is the resampling filter
+ * returns 0 on success and 8 if memory could not be allocated
+ */
+int resize(Image *im, int outCols, int outRows, Filter filter);
+
+/* ReadPPMResized
+ * Read a PPM-formatted image from a file (assumes fp != NULL) and
+ * resample it while decoding. Source rows are reduced as they are read,
+ * so only one source row, its column sums and the output image are ever
+ * held in memory.
+ * Produces the same pixels as ReadPPM followed by resize. A zero
+ * dimension is derived as in fitDims.
+ */
+Image* ReadPPMResized(FILE *fp, int outCols, int outRows, Filter filter);
+
+#endif // _RESIZE_H_
@@ -0,0 +1,349 @@
+#include <stdio.h>
+#include <stdlib.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "ppm_io.h"
+#include "img_processing.h"
+#include "img_reference.h"
+#include "resize.h"
+#include "verify.h"
+
+//number of randomly sized images generated on top of the edge cases
+#define VERIFY_RANDOM_SHAPES 8
+//largest dimension of a randomly sized image
+#define VERIFY_MAX_DIM 96
+//analyze is checked with 1 to this many threads, so rows land on band edges
+#define VERIFY_MAX_THREADS 4
+
+/* pixel patterns; flat images make every seam tie, ramps give small gradients */
+enum {PATTERN_NOISE, PATTERN_FLAT, PATTERN_RAMP, NUM_PATTERNS};
+static const char *patternNames[NUM_PATTERNS] = {"noise", "flat", "ramp"};
+
+/* operations covered by both backends */
+enum {OP_GRAYSCALE, OP_BINARIZE, OP_BINARIZE_AUTO, OP_GRADIENT, OP_TRANSPOSE, OP_CROP, OP_SEAM, NUM_OPS};
+static const char *opNames[NUM_OPS] = {"grayscale", "binarize", "binarize auto", "gradient", "transpose", "crop", "seam"};
+
+/* A struct to describe one operation and its parameters */
+typedef struct _case {
+    int op;
+    int arg[4];       // binarize threshold, crop corners
+    float scale[2];   // seam column and row scale
+} Case;
+
+/* fill im with a cols x rows image of the given pattern */
+static int makeImage(Image *im, int cols, int rows, int pattern) {
+    im->data = malloc(sizeof(Pixel) * rows * cols);
+    if (!im->data) {return -1;}
+    im->rows = rows;
+    im->cols = cols;
+    for (int r = 0; r < rows; r++) {
+        for (int c = 0; c < cols; c++) {
+            Pixel *p = &im->data[(r * cols) + c];
+            if (pattern == PATTERN_NOISE) {
+                p->r = rand() % 256;
+                p->g = rand() % 256;
+                p->b = rand() % 256;
+            } else if (pattern == PATTERN_FLAT) {
+                p->r = p->g = p->b = 128;
+            } else {
+                p->r = (3 * c + r) % 256;
+                p->g = (c + 5 * r) % 256;
+                p->b = (c * r) % 256;
+            }
+        }
+    }
+    return 0;
+}
+
+/* run one case on im with the given backend; returns 8 if memory ran out */
+static int apply(const Backend *be, const Case *k, Image *im) {
+    switch (k->op) {
+        case OP_GRAYSCALE:
+            be->grayscale(im);
+            return 0;
+        case OP_BINARIZE:
+            be->binarize(im, k->arg[0]);
+            return 0;
+        case OP_BINARIZE_AUTO:
+            return be->binarizeAuto(im);
+        case OP_GRADIENT:
+            return be->gradient(im);
+        case OP_TRANSPOSE:
+            return be->transpose(im);
+        case OP_CROP:
+            //no input file to close, so crop just returns 8 on failure
+            return (be->crop(im, k->arg[0], k->arg[1], k->arg[2], k->arg[3], NULL) == 8) ? 8 : 0;
+        default:
+            return be->seam(im, k->scale[0], k->scale[1]);
+    }
+}
+
+/* compare the fast and reference results of one case, named by what;
+ * print the first mismatch and return -1 if they differ
+ */
+static int compare(const char *what, const Image *src, int pattern, const Image *fast, const Image *ref) {
+    if (fast->rows != ref->rows || fast->cols != ref->cols) {
+        fprintf(stderr, "verify: %s on %dx%d %s image: output is %dx%d, reference is %dx%d\n", what,
+                src->cols, src->rows, patternNames[pattern], fast->cols, fast->rows, ref->cols, ref->rows);
+        return -1;
+    }
+    for (int r = 0; r < ref->rows; r++) {
+        for (int c = 0; c < ref->cols; c++) {
+            Pixel f = fast->data[(r * ref->cols) + c], e = ref->data[(r * ref->cols) + c];
+            if (f.r != e.r || f.g != e.g || f.b != e.b) {
+                fprintf(stderr, "verify: %s on %dx%d %s image: first mismatch at (%d, %d): "
+                        "fast (%d, %d, %d), reference (%d, %d, %d)\n", what, src->cols, src->rows,
+                        patternNames[pattern], c, r, f.r, f.g, f.b, e.r, e.g, e.b);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+/* check that decoding src with ReadPPMResized gives the same pixels as
+ * ReadPPM followed by resize, for both filters and a spread of output
+ * sizes (down, up, unchanged, 1x1 and derived from one dimension).
+ * Adds the number of checks to total; returns the number of mismatches,
+ * or -1 if the round trip through a temporary file failed.
+ */
+static int verifyThumb(const Image *src, int pattern, int *total) {
+    int sizes[7][2] = {
+        {src->cols / 2 + 1, src->rows / 3 + 1}, {2 * src->cols + 1, src->rows + 3},
+        {src->cols, src->rows}, {1, 1}, {src->cols + 5, 0}, {0, src->rows / 2 + 1}, {3, 2 * src->rows}
+    };
+    static const Filter filters[] = {FILTER_BOX, FILTER_BILINEAR};
+    static const char *filterNames[] = {"box", "bilinear"};
+
+    FILE *fp = tmpfile();
+    if (!fp) {return -1;}
+    if (WritePPM(fp, src) == -1) {
+        fclose(fp);
+        return -1;
+    }
+
+    int failed = 0;
+    for (int f = 0; f < 2; f++) {
+        for (int i = 0; i < 7; i++) {
+            int cols = sizes[i][0], rows = sizes[i][1];
+            rewind(fp);
+            Image *thumb = ReadPPMResized(fp, cols, rows, filters[f]);
+            rewind(fp);
+            Image *ref = ReadPPM(fp);
+            if (!thumb || !ref || fitDims(src->cols, src->rows, &cols, &rows) == -1
+                || resize(ref, cols, rows, filters[f]) != 0) {
+                if (thumb) {destroy(thumb);}
+                if (ref) {destroy(ref);}
+                fclose(fp);
+                return -1;
+            }
+
+            char what[64];
+            snprintf(what, sizeof(what), "thumb %s %dx%d", filterNames[f], sizes[i][0], sizes[i][1]);
+            if (compare(what, src, pattern, thumb, ref) == -1) {failed++;}
+            (*total)++;
+            destroy(thumb);
+            destroy(ref);
+        }
+    }
+    fclose(fp);
+    return failed;
+}
+
+/* histogram of the red channel of a gray image */
+static void grayHist(const Image *im, long long hist[256]) {
+    for (int i = 0; i < 256; i++) {
+        hist[i] = 0;
+    }
+    for (int i = 0; i < im->rows * im->cols; i++) {
+        hist[im->data[i].r]++;
+    }
+}
+
+/* compare two histograms; print the first differing bin and return -1 */
+static int compareHist(const char *what, const Image *src, int pattern, int threads,
+                       const long long *fast, const long long *ref) {
+    for (int i = 0; i < 256; i++) {
+        if (fast[i] != ref[i]) {
+            fprintf(stderr, "verify: analyze (%d threads) on %dx%d %s image: %s histogram differs at bin %d: "
+                    "fast %lld, reference %lld\n", threads, src->cols, src->rows, patternNames[pattern],
+                    what, i, fast[i], ref[i]);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* check that analyzeImage, whose threads each keep a rolling window of
+ * luma rows, gives the histograms of grayscaleRef and gradientRef output,
+ * and the same luma plane. Every thread count from 1 to VERIFY_MAX_THREADS
+ * is tried, so first, last and band edge rows all meet the window edges.
+ * Adds the number of checks to total; returns the number of mismatches,
+ * or -1 if memory ran out.
+ */
+static int verifyAnalyze(Image *src, int pattern, int *total) {
+    Image gray, grad;
+    copyIm(src, &gray);
+    copyIm(src, &grad);
+    unsigned char *lum = malloc(src->rows * src->cols);
+    if (!gray.data || !grad.data || !lum || gradientRef(&grad) == 8) {
+        free(gray.data);
+        free(grad.data);
+        free(lum);
+        return -1;
+    }
+    grayscaleRef(&gray);
+
+    long long lumaHist[256], energyHist[256];
+    grayHist(&gray, lumaHist);
+    grayHist(&grad, energyHist);
+
+    int failed = 0, status = 0;
+#ifdef _OPENMP
+    int saved = omp_get_max_threads();
+#endif
+    for (int threads = 1; threads <= VERIFY_MAX_THREADS && !status; threads++) {
+#ifdef _OPENMP
+        omp_set_num_threads(threads);
+#endif
+        Stats st;
+        if (analyzeImage(src, &st, lum, 1) == 8) {
+            status = -1;
+            break;
+        }
+        int bad = compareHist("luma", src, pattern, threads, st.lumaHist, lumaHist) == -1
+                  || compareHist("energy", src, pattern, threads, st.energyHist, energyHist) == -1;
+        for (int i = 0; !bad && i < src->rows * src->cols; i++) {
+            if (lum[i] != gray.data[i].r) {
+                fprintf(stderr, "verify: analyze (%d threads) on %dx%d %s image: luma plane differs at (%d, %d)\n",
+                        threads, src->cols, src->rows, patternNames[pattern], i % src->cols, i / src->cols);
+                bad = 1;
+            }
+        }
+        if (bad) {failed++;}
+        (*total)++;
+    }
+#ifdef _OPENMP
+    omp_set_num_threads(saved);
+#endif
+
+    free(gray.data);
+    free(grad.data);
+    free(lum);
+    return status ? status : failed;
+}
+
+/* build the list of cases that are valid for a cols x rows image */
+static int makeCases(Case *cases, int cols, int rows) {
+    int n = 0;
+    Case base = {OP_GRAYSCALE, {0, 0, 0, 0}, {0, 0}};
+    static const float scales[][2] = {{0, 0}, {0.5f, 0.5f}, {1, 1}, {0.3f, 1}, {1, 0.3f}};
+    static const int thresholds[] = {0, 1, 127, 255};
+
+    cases[n] = base;
+    cases[n++].op = OP_GRAYSCALE;
+    for (int i = 0; i < 4; i++) {
+        cases[n] = base;
+        cases[n].op = OP_BINARIZE;
+        cases[n++].arg[0] = thresholds[i];
+    }
+    cases[n] = base;
+    cases[n].op = OP_BINARIZE;
+    cases[n++].arg[0] = rand() % 256;
+    cases[n] = base;
+    cases[n++].op = OP_BINARIZE_AUTO;
+    cases[n] = base;
+    cases[n++].op = OP_GRADIENT;
+    cases[n] = base;
+    cases[n++].op = OP_TRANSPOSE;
+
+    //crop needs x1 < x2 < cols and y1 < y2 < rows
+    if (cols >= 2 && rows >= 2) {
+        cases[n] = base;
+        cases[n].op = OP_CROP;
+        cases[n].arg[2] = cols - 1;
+        cases[n++].arg[3] = rows - 1;
+
+        cases[n] = base;
+        cases[n].op = OP_CROP;
+        cases[n].arg[0] = rand() % (cols - 1);
+        cases[n].arg[1] = rand() % (rows - 1);
+        cases[n].arg[2] = cases[n].arg[0] + 1 + rand() % (cols - 1 - cases[n].arg[0]);
+        cases[n].arg[3] = cases[n].arg[1] + 1 + rand() % (rows - 1 - cases[n].arg[1]);
+        n++;
+    }
+
+    for (int i = 0; i < 5; i++) {
+        cases[n] = base;
+        cases[n].op = OP_SEAM;
+        cases[n].scale[0] = scales[i][0];
+        cases[n++].scale[1] = scales[i][1];
+    }
+    cases[n] = base;
+    cases[n].op = OP_SEAM;
+    cases[n].scale[0] = (rand() % 101) / 100.0f;
+    cases[n++].scale[1] = (rand() % 101) / 100.0f;
+    return n;
+}
+
+int verifyBackends(unsigned seed) {
+    //edge cases first (cols, rows), then random shapes
+    int shapes[16 + VERIFY_RANDOM_SHAPES][2] = {
+        {1, 1}, {1, 17}, {17, 1}, {1, 64}, {64, 1}, {2, 2}, {3, 3}, {2, 9},
+        {9, 2}, {3, 7}, {7, 3}, {5, 5}, {33, 17}, {17, 33}, {101, 9}, {9, 101}
+    };
+    int numShapes = 16 + VERIFY_RANDOM_SHAPES;
+    srand(seed);
+    for (int i = 16; i < numShapes; i++) {
+        shapes[i][0] = 1 + rand() % VERIFY_MAX_DIM;
+        shapes[i][1] = 1 + rand() % VERIFY_MAX_DIM;
+    }
+
+    int total = 0, failed = 0;
+    Case cases[32];
+    for (int s = 0; s < numShapes; s++) {
+        for (int pattern = 0; pattern < NUM_PATTERNS; pattern++) {
+            Image src;
+            if (makeImage(&src, shapes[s][0], shapes[s][1], pattern) == -1) {
+                fprintf(stderr, "verify: failed to allocate memory for test image!\n");
+                return 8;
+            }
+
+            int numCases = makeCases(cases, src.cols, src.rows);
+            for (int k = 0; k < numCases; k++) {
+                Image fast, ref;
+                copyIm(&src, &fast);
+                copyIm(&src, &ref);
+                if (apply(&fastBackend, &cases[k], &fast) == 8 || apply(&refBackend, &cases[k], &ref) == 8) {
+                    fprintf(stderr, "verify: %s on %dx%d %s image: out of memory\n", opNames[cases[k].op],
+                            src.cols, src.rows, patternNames[pattern]);
+                    failed++;
+                } else if (compare(opNames[cases[k].op], &src, pattern, &fast, &ref) == -1) {failed++;}
+                total++;
+                free(fast.data);
+                free(ref.data);
+            }
+
+            int analyzeFailed = verifyAnalyze(&src, pattern, &total);
+            if (analyzeFailed == -1) {
+                fprintf(stderr, "verify: failed to allocate memory for analyze!\n");
+                free(src.data);
+                return 8;
+            }
+            failed += analyzeFailed;
+
+            int thumbFailed = verifyThumb(&src, pattern, &total);
+            if (thumbFailed == -1) {
+                fprintf(stderr, "verify: thumbnail round trip through a temporary file failed!\n");
+                free(src.data);
+                return 8;
+            }
+            failed += thumbFailed;
+            free(src.data);
+        }
+    }
+
+    printf("verify: %d cases, %d mismatches (seed %u)\n", total, failed, seed);
+    return failed ? 8 : 0;
+}
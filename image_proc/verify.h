@@ -0,0 +1,16 @@
+#ifndef _VERIFY_H_
+#define _VERIFY_H_
+
+/* function to run every operation through both the fast and the reference
+ * backend on generated images (random sizes plus edge cases such as 1xN,
+ * Nx1, 2x2 and odd widths) and compare the outputs pixel for pixel. Each
+ * image is also analyzed with 1 to 4 threads and its histograms compared
+ * with those of the reference grayscale and gradient, and decoded with
+ * ReadPPMResized and compared with ReadPPM followed by resize. The first
+ * mismatch of every failing case is printed on stderr.
+ * @param seed seeds the image and parameter generator
+ * returns 0 if every case matched, otherwise 8
+ */
+int verifyBackends(unsigned seed);
+
+#endif // _VERIFY_H_